@@ -1,15 +1,40 @@
 #pragma once
 
 #include "argparse.hpp"
+#include "counters.hpp"
 #include "random.hpp"
+#include "topology.hpp"
+#include "trace.hpp"
+#include "xoshiro.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <boost/container_hash/hash.hpp>
+#include <gvc.h>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -17,9 +42,59 @@
 #define t1_prefix "O_"
 #define t2_prefix "R_"
 
+// Text output is formatted into a TextBuffer, numbers through to_chars, and
+// written out in one go
+struct TextBuffer {
+  std::string text;
+
+  void clear() { text.clear(); }
+  std::string_view view() const { return text; }
+
+  TextBuffer &operator<<(std::string_view s) {
+    text += s;
+    return *this;
+  }
+  TextBuffer &operator<<(char c) {
+    text += c;
+    return *this;
+  }
+  template <typename T>
+  std::enable_if_t<std::is_integral_v<T>, TextBuffer &> operator<<(T value) {
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    text.append(digits, end);
+    return *this;
+  }
+
+  bool write(const std::string &file_name) const {
+    std::ofstream f(file_name, std::ios::binary);
+    f.write(text.data(), text.size());
+    return static_cast<bool>(f);
+  }
+};
+
 // get base random alias which is auto seeded and has static API and internal
-// state
-using Random = effolkronium::random_static;
+// state, one per thread so that trial runs can go on side by side.
+// xoshiro256++ unless built with AUTOGRAPH_MT19937.
+#ifdef AUTOGRAPH_MT19937
+using Random = effolkronium::random_thread_local;
+#else
+using Random = effolkronium::basic_random_thread_local<
+    Xoshiro256pp, effolkronium::seeder_default, LemireIntDistribution,
+    std::uniform_real_distribution, ThresholdBernoulliDistribution>;
+#endif
+
+// Set by the SIGTERM handler, checked between generations so that a
+// pre-empted run can checkpoint before exiting
+inline volatile std::sig_atomic_t stop_requested = 0;
+
+void request_stop(int) { stop_requested = 1; }
+
+// SIGTERM stops the run with a checkpoint, SIGUSR1 prints the counters
+void handle_signals() {
+  std::signal(SIGTERM, request_stop);
+  std::signal(SIGUSR1, request_report);
+}
 
 struct Pos {
   int x;
@@ -55,23 +130,41 @@ bool Segment::intersects(Segment &s2) {
 struct Node {
   unsigned int id;
   Pos pos;
-  // std::string label;
+
+  // Id of this node's label in its graph's Labels
+  unsigned int label;
   std::unordered_set<int> connections;
   bool is_t1;
 
-  Node() { is_t1 = true; };
+  Node() {
+    is_t1 = true;
+    label = no_label;
+  };
 
-  std::string as_dot() {
-    std::string dot = "  ";
+  void append_dot(TextBuffer &dot, const Labels *labels = nullptr) {
+    dot << "  ";
     if (is_t1) {
-      dot += t1_prefix + std::to_string(id) + " [color = blue, ";
+      dot << t1_prefix << id << " [color = blue, ";
     } else {
-      dot += t2_prefix + std::to_string(id) + " [color = red, ";
+      dot << t2_prefix << id << " [color = red, ";
+    }
+    if (labels && label != no_label) {
+      dot << "label = \"";
+      for (char ch : (*labels)[label]) {
+        if (ch == '"' || ch == '\\') {
+          dot << '\\';
+        }
+        dot << ch;
+      }
+      dot << "\", ";
     }
-    // dot += "label = " + label + ", "
-    dot += "pos = \"" + std::to_string(pos.x) + "," + std::to_string(pos.y) +
-           "!\"];\n";
-    return dot;
+    dot << "pos = \"" << pos.x << "," << pos.y << "!\"];\n";
+  }
+
+  std::string as_dot(const Labels *labels = nullptr) {
+    TextBuffer dot;
+    append_dot(dot, labels);
+    return std::string(dot.view());
   }
 };
 
@@ -85,15 +178,79 @@ struct Edge {
     weight = w;
   }
 
+  void append_dot(TextBuffer &dot) {
+    dot << "  " << t1_prefix << from << " -- " << t2_prefix << to;
+    dot << "[label = \"" << weight << "\"];\n";
+  }
+
   std::string as_dot() {
-    std::string dot = "  ";
-    dot += t1_prefix + std::to_string(from) + " -- " + t2_prefix +
-           std::to_string(to);
-    dot += "[label = \"" + std::to_string(weight) + "\"];\n";
-    return dot;
+    TextBuffer dot;
+    append_dot(dot);
+    return std::string(dot.view());
   }
 };
 
+// Relative odds of each kind of move in Bipartate::mutate
+using MutationWeights = std::array<unsigned int, n_mutation_types>;
+
+// Moves of each kind a mutation made
+using MoveCounts = std::array<unsigned int, n_mutation_types>;
+
+// Pick a kind of move, 1 to n_mutation_types
+uint8_t pick_mutation(const MutationWeights &weights) {
+
+  // Equal odds take the same draw as without weights
+  if (std::adjacent_find(weights.begin(), weights.end(),
+                         std::not_equal_to<>()) == weights.end()) {
+    return Random::get<uint8_t>(1, n_mutation_types);
+  }
+  unsigned int r = Random::get<unsigned int>(
+      1, std::accumulate(weights.begin(), weights.end(), 0u));
+  uint8_t mutation = 1;
+  for (; r > weights[mutation - 1]; mutation++) {
+    r -= weights[mutation - 1];
+  }
+  return mutation;
+}
+
+// Weights written as a,b,c, not all 0
+MutationWeights parse_mutation_weights(const std::string &text) {
+  MutationWeights weights;
+  const char *p = text.data();
+  const char *end = p + text.size();
+  bool ok = true;
+  for (unsigned int i = 0; i < n_mutation_types && ok; i++) {
+    auto [next, ec] = std::from_chars(p, end, weights[i]);
+
+    // A comma after every weight but the last, which ends the text
+    bool last = i + 1 == n_mutation_types;
+    ok = ec == std::errc() &&
+         (last ? next == end : next != end && *next == ',');
+    p = next + 1;
+  }
+  if (!ok) {
+    throw std::runtime_error(
+        "--mutation_weights must be three integers, as 1,1,1");
+  }
+  if (std::all_of(weights.begin(), weights.end(),
+                  [](unsigned int w) { return !w; })) {
+    throw std::runtime_error("--mutation_weights must not all be 0");
+  }
+  return weights;
+}
+
+// Key of one node at one position. A layout hashes to the XOR of the keys of
+// all its nodes, so moving a node updates the hash in O(1).
+uint64_t zobrist(const Node &node, Pos p) {
+  auto mix = [](uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  };
+  return mix(mix(uint64_t(node.id) << 1 | node.is_t1) ^
+             (uint64_t(uint32_t(p.x)) << 32 | uint32_t(p.y)));
+}
+
 struct Bipartate {
 
   unsigned int score;
@@ -102,12 +259,35 @@ struct Bipartate {
   std::vector<Edge> edges;
   std::unordered_map<std::pair<int, int>, int, boost::hash<std::pair<int, int>>>
       positions;
-  Bipartate(std::string csv_name);
+
+  // Node labels, shared by every copy of the graph
+  std::shared_ptr<const Labels> labels;
+
+  // Counts every copy made of a specimen
+  [[no_unique_address]] CopyCounter copies;
+
+  // Zobrist hash of every node's position, kept up to date by move()
+  uint64_t layout_hash = 0;
+
+  Bipartate(std::string csv_name, bool use_cache = true);
+  Bipartate(const Topology &topology);
   Bipartate(){};
   void write_dot(std::string file_name);
-  Bipartate mutate(uint8_t chance);
+  bool render(GVC_t *gvc, std::string file_name, std::string format);
+  void write_heatmap(std::string file_name, unsigned int max_size);
+  void write_reordered(std::string file_name, std::string perm_name);
+  std::vector<unsigned int> order(bool c);
+  std::vector<unsigned int> edges_by_row(std::vector<unsigned int> &row_start);
+  Bipartate mutate(uint8_t chance, bool score = true,
+                   const MutationWeights &weights = {1, 1, 1},
+                   MoveCounts *moves = nullptr);
   void calc_score();
   bool is_adjacent(int x, int y);
+  std::vector<Pos> genome();
+  void set_genome(const std::vector<Pos> &g);
+  uint64_t genome_hash();
+  uint64_t hash_positions();
+  void move(Node &node, Pos p);
 
   // Overloading "<" operator based on score
   bool operator<(const Bipartate &rhs) const { return score < rhs.score; }
@@ -119,51 +299,51 @@ struct Bipartate {
   }
 };
 
-Bipartate::Bipartate(std::string csv_name) {
-
-  // https://stackoverflow.com/questions/48994605/csv-data-into-a-2d-array-of-integers
-  std::ifstream f;
-  f.open(csv_name);
+Bipartate::Bipartate(std::string csv_name, bool use_cache)
+    : Bipartate(load_topology(csv_name, use_cache)) {}
 
-  // Number of lines read
-  unsigned int n_row = 0;
+Bipartate::Bipartate(const Topology &topology) {
 
-  // Buffer to hold one row, one value
-  std::string row, val;
-  std::vector<std::vector<int>> array;
+  // t1, t2 and connections are not reserved: bucket counts set the order
+  // they iterate in, and so the initial layout and the moves picked
+  edges.reserve(topology.n_edges());
+  positions.reserve(topology.n_t1 + topology.n_t2);
 
-  // Read one row at a time
-  while (std::getline(f, row)) {
-    std::stringstream s(row);
-
-    // Initialise t1 at n_row
-    t1[n_row].id = n_row;
+  if (topology.labels.size()) {
+    labels = std::make_shared<const Labels>(topology.labels);
+  }
 
-    // Column index
-    unsigned int n_col = 0;
+  // Initialise every column, including ones without any links
+  for (unsigned int n_col = 0; n_col < topology.n_t2; n_col++) {
+    t2[n_col].id = n_col;
+    if (!topology.t2_labels.empty()) {
+      t2[n_col].label = topology.t2_labels[n_col];
+    }
+  }
 
-    // Read one , delimitted value at a time
-    while (getline(s, val, ',')) {
-      int weight = std::stoi(val);
+  for (unsigned int n_row = 0; n_row < topology.n_t1; n_row++) {
 
-      // Initialise t2 at n_col
-      t2[n_col].id = n_col;
+    // Initialise t1 at n_row
+    Node &n = t1[n_row];
+    n.id = n_row;
+    if (!topology.t1_labels.empty()) {
+      n.label = topology.t1_labels[n_row];
+    }
+    unsigned int begin = topology.offsets[n_row];
+    unsigned int end = topology.offsets[n_row + 1];
 
-      // If linked
-      if (weight) {
+    for (unsigned int e = begin; e < end; e++) {
+      unsigned int n_col = topology.neighbours[e];
 
-        // Add connection from t1 to t2
-        t1[n_row].connections.insert(n_col);
+      // Add connection from t1 to t2
+      n.connections.insert(n_col);
 
-        // Add connection from t2 to t1
-        t2[n_col].connections.insert(n_row);
+      // Add connection from t2 to t1
+      t2[n_col].connections.insert(n_row);
 
-        // Add edge from t1 to t2
-        edges.push_back(Edge(n_row, n_col, weight));
-      }
-      n_col++;
+      // Add edge from t1 to t2
+      edges.push_back(Edge(n_row, n_col, topology.weights[e]));
     }
-    n_row++;
   }
 
   // First tower
@@ -187,7 +367,7 @@ Bipartate::Bipartate(std::string csv_name) {
     it.second.is_t1 = false;
     y++;
   }
-  write_dot("input.dot");
+  layout_hash = hash_positions();
 }
 
 bool Bipartate::is_adjacent(int x, int y) {
@@ -196,117 +376,466 @@ bool Bipartate::is_adjacent(int x, int y) {
          positions.contains({x + 1, y}) || positions.contains({x - 1, y});
 }
 
-Bipartate Bipartate::mutate(uint8_t chance) {
+// Copy with nodes moved at random, scored unless the caller scores it later.
+// The moves which changed the layout are counted into moves if given.
+Bipartate Bipartate::mutate(uint8_t chance, bool score,
+                            const MutationWeights &weights,
+                            MoveCounts *moves) {
+  AUTOGRAPH_TRACE_SCOPE("mutate");
 
   // Make a copy as the result we will return
   Bipartate bm(*this);
 
-  for (bool c : {true, false}) {
-    for (auto &it : bm(c)) {
-
-      // Should this node mutate?
-      if (Random::get<uint8_t>(1, 100) < chance) {
-
-        uint8_t mutation = Random::get<uint8_t>(1, 3);
-
-        int x = it.second.pos.x;
-        int y = it.second.pos.y;
-
-        switch (mutation) {
-
-          // Move vertically
-        case 1:
+  // Counted here, and added to the shared counters once at the end
+  uint64_t attempted[n_mutation_types] = {};
+  uint64_t applied[n_mutation_types] = {};
+
+  // Each node mutates with probability (chance - 1) / 100, as when a draw
+  // of 1 to 100 below chance picked it. Only the gaps between the nodes that
+  // mutate are drawn, so the draws needed scale with the number of moves.
+  // From chance 101 every node mutates, which the distribution cannot draw
+  // as it needs p < 1.
+  double p = std::max((chance - 1) / 100.0, 0.001);
+  std::geometric_distribution<unsigned int> gap(p < 1 ? p : 0.5);
+  auto next_gap = [&]() -> unsigned long {
+    return p < 1 ? Random::get(gap) : 0;
+  };
 
-          // Swap with neighbour above/below
-          if (is_adjacent(x, y)) {
-            int new_y = Random::get<bool>() ? y + 1 : y - 1;
+  for (bool c : {true, false}) {
 
-            it.second.pos.y = new_y;
-            if (bm.positions.contains({x, new_y})) {
-              bm(c)[bm.positions[{x, new_y}]].pos.y = y;
-              bm.positions[{x, y}] = bm(c)[bm.positions[{x, new_y}]].id;
-            }
-            bm.positions[{x, new_y}] = it.second.id;
+    // Walked rather than looked up, moves never add or remove nodes
+    auto it = bm(c).begin();
+    unsigned long n_left = chance > 1 ? bm(c).size() : 0;
+    for (unsigned long skip = next_gap(); skip < n_left;
+         skip = next_gap(), ++it) {
+      std::advance(it, skip);
+      n_left -= skip + 1;
+      Node &node = it->second;
+      uint8_t mutation = pick_mutation(weights);
+      attempted[mutation - 1]++;
+
+      int x = node.pos.x;
+      int y = node.pos.y;
+
+      switch (mutation) {
+
+        // Move vertically
+      case 1:
+
+        // Swap with neighbour above/below
+        if (is_adjacent(x, y)) {
+          int new_y = Random::get<bool>() ? y + 1 : y - 1;
+          applied[0]++;
+
+          bm.move(node, Pos(x, new_y));
+          if (bm.positions.contains({x, new_y})) {
+            Node &other = bm(c)[bm.positions[{x, new_y}]];
+            bm.move(other, Pos(other.pos.x, y));
+            bm.positions[{x, y}] = other.id;
           }
-          break;
-
-          // Move horizontally
-        case 2:
-
-          // Swap with to right
-          if (Random::get<bool>() && is_adjacent(x + 2, y)) {
-            it.second.pos.x = x + 2;
-            if (bm.positions.contains({x + 2, y})) {
-              bm(c)[bm.positions[{x + 2, y}]].pos.x = x;
-              bm.positions[{x, y}] = bm(c)[bm.positions[{x + 2, y}]].id;
-            }
-            bm.positions[{x + 2, y}] = it.second.id;
+          bm.positions[{x, new_y}] = node.id;
+        }
+        break;
+
+        // Move horizontally
+      case 2:
+
+        // Swap with to right
+        if (Random::get<bool>() && is_adjacent(x + 2, y)) {
+          applied[1]++;
+          bm.move(node, Pos(x + 2, y));
+          if (bm.positions.contains({x + 2, y})) {
+            Node &other = bm(c)[bm.positions[{x + 2, y}]];
+            bm.move(other, Pos(x, other.pos.y));
+            bm.positions[{x, y}] = other.id;
           }
-          // Swap with neighbour to left
-          else if (is_adjacent(x - 2, y)) {
-            it.second.pos.x = x - 2;
-            if (bm.positions.contains({x - 2, y})) {
-              bm(c)[bm.positions[{x - 2, y}]].pos.x = x;
-              bm.positions[{x, y}] = bm(c)[bm.positions[{x - 2, y}]].id;
-            }
-            bm.positions[{x - 2, y}] = it.second.id;
+          bm.positions[{x + 2, y}] = node.id;
+        }
+        // Swap with neighbour to left
+        else if (is_adjacent(x - 2, y)) {
+          applied[1]++;
+          bm.move(node, Pos(x - 2, y));
+          if (bm.positions.contains({x - 2, y})) {
+            Node &other = bm(c)[bm.positions[{x - 2, y}]];
+            bm.move(other, Pos(x, other.pos.y));
+            bm.positions[{x, y}] = other.id;
           }
-          break;
-
-          // Move to front
-        case 3:
-          if (it.second.connections.size() > 0) {
-            int move_to = *(Random::get(it.second.connections));
-            int new_y = bm(!c)[move_to].pos.y;
-            it.second.pos.y = new_y;
-            if (bm.positions.contains({x, new_y})) {
-              bm(c)[bm.positions[{x, new_y}]].pos.y = y;
-              bm.positions[{x, y}] = bm(c)[bm.positions[{x, new_y}]].id;
-            }
-            bm.positions[{x, new_y}] = it.second.id;
+          bm.positions[{x - 2, y}] = node.id;
+        }
+        break;
+
+        // Move to front
+      case 3:
+        if (node.connections.size() > 0) {
+          int move_to = *(Random::get(node.connections));
+          int new_y = bm(!c)[move_to].pos.y;
+          applied[2] += new_y != y;
+          bm.move(node, Pos(x, new_y));
+          if (bm.positions.contains({x, new_y})) {
+            Node &other = bm(c)[bm.positions[{x, new_y}]];
+            bm.move(other, Pos(other.pos.x, y));
+            bm.positions[{x, y}] = other.id;
           }
-          break;
-          // case 4:
-          //   std::cout << "Swap Randomly\n";
-          //   break;
+          bm.positions[{x, new_y}] = node.id;
         }
+        break;
+        // case 4:
+        //   std::cout << "Swap Randomly\n";
+        //   break;
       }
     }
   }
-  bm.calc_score();
+  for (unsigned int i = 0; i < n_mutation_types; i++) {
+    counters.add(counters.mutations_attempted[i], attempted[i]);
+    counters.add(counters.mutations_applied[i], applied[i]);
+    if (moves) {
+      (*moves)[i] = applied[i];
+    }
+  }
+  if (score) {
+    bm.calc_score();
+  }
   return bm;
 }
 
 void Bipartate::write_dot(std::string file_name) {
-  std::ofstream f;
-  f.open(file_name);
-  std::cout << "Writing " << file_name << std::endl;
-  f << "graph autograph {\n";
+  AUTOGRAPH_TRACE_SCOPE("write_dot");
+
+  // One write, so lines from the snapshot thread stay whole
+  std::cout << "Writing " + file_name + "\n" << std::flush;
+
+  // Formatted into one buffer, reused between calls, and written at once
+  static thread_local TextBuffer dot;
+  dot.clear();
+  dot << "graph autograph {\n";
 
   // Nodes
-  f << std::endl;
-  f << "  // Nodes\n";
+  dot << "\n";
+  dot << "  // Nodes\n";
   for (auto &it : t1) {
-    f << it.second.as_dot();
+    it.second.append_dot(dot, labels.get());
   }
   for (auto &it : t2) {
-    f << it.second.as_dot();
+    it.second.append_dot(dot, labels.get());
   }
 
   // Edges
-  f << std::endl;
-  f << "  // Edges\n";
-  for (Edge e : edges) {
-    f << e.as_dot();
+  dot << "\n";
+  dot << "  // Edges\n";
+  for (Edge &e : edges) {
+    e.append_dot(dot);
   }
 
-  f << "\n}\n";
-  f.close();
-  return;
+  dot << "\n}\n";
+  dot.write(file_name);
+}
+
+// Older libgvc takes char * even for strings it does not change
+void set_attribute(void *object, const char *name, const std::string &value) {
+  agsafeset(object, const_cast<char *>(name), const_cast<char *>(value.c_str()),
+            const_cast<char *>(""));
+}
+
+// Render straight to an image (pdf, svg, png...) through libgvc, laid out
+// like `dot -Kneato` lays out the output of write_dot
+bool Bipartate::render(GVC_t *gvc, std::string file_name, std::string format) {
+  AUTOGRAPH_TRACE_SCOPE("render");
+  std::cout << "Rendering " + file_name + "\n" << std::flush;
+
+  std::string name = "autograph";
+  Agraph_t *g = agopen(name.data(), Agundirected, nullptr);
+
+  // Nodes, by id so edges can find them
+  std::vector<Agnode_t *> nodes[2];
+  for (bool c : {true, false}) {
+    auto &tower = (*this)(c);
+    nodes[c].resize(tower.size());
+    for (unsigned int id = 0; id < tower.size(); ++id) {
+      Node &n = tower[id];
+      name = (c ? t1_prefix : t2_prefix) + std::to_string(id);
+      Agnode_t *node = agnode(g, name.data(), 1);
+      set_attribute(node, "color", c ? "blue" : "red");
+      if (labels && n.label != no_label) {
+        set_attribute(node, "label", std::string((*labels)[n.label]));
+      }
+      set_attribute(node, "pos", std::to_string(n.pos.x) + "," +
+                                     std::to_string(n.pos.y) + "!");
+      nodes[c][id] = node;
+    }
+  }
+
+  // Edges
+  for (Edge &e : edges) {
+    Agedge_t *edge = agedge(g, nodes[true][e.from], nodes[false][e.to],
+                            nullptr, 1);
+    set_attribute(edge, "label", std::to_string(e.weight));
+  }
+
+  bool ok = !gvLayout(gvc, g, "neato") &&
+            !gvRenderFilename(gvc, g, format.c_str(), file_name.c_str());
+  gvFreeLayout(gvc, g);
+  agclose(g);
+  if (!ok) {
+    std::cerr << "ERROR: Could not render " << file_name << std::endl;
+  }
+  return ok;
+}
+
+// Ids of the nodes of a tower from top to bottom, by y and then by x
+std::vector<unsigned int> Bipartate::order(bool c) {
+  auto &tower = (*this)(c);
+  std::vector<Pos> pos(tower.size());
+  for (auto &it : tower) {
+    pos[it.first] = it.second.pos;
+  }
+
+  std::vector<unsigned int> ids(tower.size());
+  std::iota(ids.begin(), ids.end(), 0);
+  std::sort(ids.begin(), ids.end(), [&](unsigned int a, unsigned int b) {
+    return pos[a].y < pos[b].y || (pos[a].y == pos[b].y && pos[a].x < pos[b].x);
+  });
+  return ids;
+}
+
+// Indices into edges grouped by t1 node, by counting sort. The edges of
+// node r are listed from row_start[r] to row_start[r + 1].
+std::vector<unsigned int>
+Bipartate::edges_by_row(std::vector<unsigned int> &row_start) {
+  row_start.assign(t1.size() + 1, 0);
+  for (Edge &e : edges) {
+    row_start[e.from + 1]++;
+  }
+  for (size_t r = 0; r < t1.size(); r++) {
+    row_start[r + 1] += row_start[r];
+  }
+  std::vector<unsigned int> by_row(edges.size());
+  std::vector<unsigned int> next(row_start.begin(), row_start.end() - 1);
+  for (unsigned int i = 0; i < edges.size(); i++) {
+    by_row[next[edges[i].from]++] = i;
+  }
+  return by_row;
+}
+
+// Append a label as a CSV cell, quoted when it has to be
+void append_csv_label(TextBuffer &out, std::string_view label) {
+  if (label.find_first_of(",\"\n") == std::string_view::npos) {
+    out << label;
+    return;
+  }
+  out << '"';
+  for (char ch : label) {
+    out << ch;
+    if (ch == '"') {
+      out << ch;
+    }
+  }
+  out << '"';
+}
+
+// The input matrix again, with rows in t1 order and columns in t2 order,
+// and labels if it had any. Alongside it perm_name lists the original row
+// ids in their new order on one line, and the column ids on the next.
+// Streamed a row at a time, so only one row of the matrix is ever held.
+void Bipartate::write_reordered(std::string file_name, std::string perm_name) {
+  std::cout << "Writing " + file_name + "\n" << std::flush;
+
+  std::vector<unsigned int> rows = order(true);
+  std::vector<unsigned int> cols = order(false);
+  std::vector<unsigned int> col_rank(cols.size());
+  for (unsigned int rank = 0; rank < cols.size(); rank++) {
+    col_rank[cols[rank]] = rank;
+  }
+
+  TextBuffer out;
+  for (bool c : {true, false}) {
+    out << (c ? "t1" : "t2");
+    for (unsigned int id : c ? rows : cols) {
+      out << ',' << id;
+    }
+    out << '\n';
+  }
+  out.write(perm_name);
+  out.clear();
+
+  std::ofstream f(file_name, std::ios::binary);
+  bool labelled = labels != nullptr;
+  if (labelled) {
+    for (unsigned int id : cols) {
+      out << ',';
+      if (t2[id].label != no_label) {
+        append_csv_label(out, (*labels)[t2[id].label]);
+      }
+    }
+    out << '\n';
+  }
+
+  std::vector<unsigned int> row_start;
+  std::vector<unsigned int> by_row = edges_by_row(row_start);
+  std::vector<int> cells(cols.size(), 0);
+  for (unsigned int id : rows) {
+    if (labelled) {
+      if (t1[id].label != no_label) {
+        append_csv_label(out, (*labels)[t1[id].label]);
+      }
+      out << ',';
+    }
+
+    for (unsigned int i = row_start[id]; i < row_start[id + 1]; i++) {
+      cells[col_rank[edges[by_row[i]].to]] = edges[by_row[i]].weight;
+    }
+    for (unsigned int rank = 0; rank < cells.size(); rank++) {
+      if (rank) {
+        out << ',';
+      }
+      out << cells[rank];
+    }
+    out << '\n';
+
+    // Clear only what this row set
+    for (unsigned int i = row_start[id]; i < row_start[id + 1]; i++) {
+      cells[col_rank[edges[by_row[i]].to]] = 0;
+    }
+
+    f.write(out.view().data(), out.view().size());
+    out.clear();
+  }
+}
+
+// Heatmap of the adjacency matrix with rows in t1 order and columns in t2
+// order, as a binary PPM or an SVG depending on the file's extension. The
+// image is at most max_size pixels each way, larger matrices are binned,
+// and it is streamed out a row of pixels at a time so memory stays bounded
+// by the size of the graph rather than that of the matrix.
+void Bipartate::write_heatmap(std::string file_name, unsigned int max_size) {
+  std::cout << "Writing " + file_name + "\n" << std::flush;
+  bool svg = file_name.ends_with(".svg");
+
+  size_t n_rows = t1.size();
+  size_t n_cols = t2.size();
+  size_t width = std::min<size_t>(n_cols, max_size);
+  size_t height = std::min<size_t>(n_rows, max_size);
+
+  // Pixel column of every t2 node
+  std::vector<unsigned int> col_px(n_cols);
+  std::vector<unsigned int> cols = order(false);
+  for (size_t rank = 0; rank < n_cols; rank++) {
+    col_px[cols[rank]] = rank * width / n_cols;
+  }
+
+  std::vector<unsigned int> row_start;
+  std::vector<unsigned int> by_row = edges_by_row(row_start);
+  int max_weight = 1;
+  for (Edge &e : edges) {
+    max_weight = std::max(max_weight, std::abs(e.weight));
+  }
+
+  std::ofstream f(file_name, std::ios::binary);
+  TextBuffer out;
+  if (svg) {
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width
+        << "\" height=\"" << height << "\" shape-rendering=\"crispEdges\">\n";
+    out << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+  } else {
+    out << "P6\n" << width << " " << height << "\n255\n";
+  }
+
+  // Matrix cells covered by a pixel, so binned pixels show density
+  double cell_area = double(n_rows) / height * double(n_cols) / width;
+  std::vector<double> pixels(width);
+  std::vector<unsigned int> rows = order(true);
+  size_t rank = 0;
+  for (size_t y = 0; y < height; y++) {
+    std::fill(pixels.begin(), pixels.end(), 0);
+    for (; rank < n_rows && rank * height / n_rows == y; rank++) {
+      unsigned int id = rows[rank];
+      for (unsigned int i = row_start[id]; i < row_start[id + 1]; i++) {
+        Edge &e = edges[by_row[i]];
+        pixels[col_px[e.to]] += double(std::abs(e.weight)) / max_weight;
+      }
+    }
+
+    for (size_t x = 0; x < width; x++) {
+
+      // White for nothing to dark blue for full, square root so that
+      // sparse regions still show
+      double shade = std::sqrt(std::min(1.0, pixels[x] / cell_area));
+      unsigned char rgb[3] = {static_cast<unsigned char>(255 - 247 * shade),
+                              static_cast<unsigned char>(255 - 207 * shade),
+                              static_cast<unsigned char>(255 - 148 * shade)};
+      if (!svg) {
+        out << static_cast<char>(rgb[0]) << static_cast<char>(rgb[1])
+            << static_cast<char>(rgb[2]);
+      } else if (pixels[x]) {
+        out << "<rect x=\"" << x << "\" y=\"" << y
+            << "\" width=\"1\" height=\"1\" fill=\"rgb(" << rgb[0] << ","
+            << rgb[1] << "," << rgb[2] << ")\"/>\n";
+      }
+    }
+
+    // Hand every row of pixels to the file before starting the next
+    f.write(out.view().data(), out.view().size());
+    out.clear();
+  }
+
+  if (svg) {
+    out << "</svg>\n";
+  }
+  f.write(out.view().data(), out.view().size());
+}
+
+// Positions of every node, t1 ordered by id followed by t2 ordered by id
+std::vector<Pos> Bipartate::genome() {
+  std::vector<Pos> g;
+  g.reserve(t1.size() + t2.size());
+  for (bool c : {true, false}) {
+    for (unsigned int id = 0; id < (*this)(c).size(); ++id) {
+      g.push_back((*this)(c)[id].pos);
+    }
+  }
+  return g;
+}
+
+// Move every node to the position given by a genome from genome()
+void Bipartate::set_genome(const std::vector<Pos> &g) {
+  positions.clear();
+  unsigned int i = 0;
+  for (bool c : {true, false}) {
+    for (unsigned int id = 0; id < (*this)(c).size(); ++id) {
+      (*this)(c)[id].pos = g[i];
+      positions[{g[i].x, g[i].y}] = id;
+      i++;
+    }
+  }
+  layout_hash = hash_positions();
+}
+
+// Hash of every node's position, equal for equal layouts
+uint64_t Bipartate::genome_hash() { return layout_hash; }
+
+// The layout hash worked out from scratch
+uint64_t Bipartate::hash_positions() {
+  uint64_t h = 0;
+  for (bool c : {true, false}) {
+    for (auto &it : (*this)(c)) {
+      h ^= zobrist(it.second, it.second.pos);
+    }
+  }
+  return h;
+}
+
+void Bipartate::move(Node &node, Pos p) {
+  layout_hash ^= zobrist(node, node.pos) ^ zobrist(node, p);
+  node.pos = p;
 }
 
 // Calculate score to optimise
 void Bipartate::calc_score() {
+  AUTOGRAPH_TRACE_SCOPE("calc_score");
+
+  uint64_t n_edges = edges.size();
+  counters.add(counters.score_calls, 1);
+  counters.add(counters.edge_pair_tests,
+               n_edges ? n_edges * (n_edges - 1) / 2 : 0);
 
   score = 0;
   for (unsigned int i = 0; i < edges.size(); ++i) {
@@ -318,6 +847,379 @@ void Bipartate::calc_score() {
   }
 }
 
+// What is written for every snapshot besides best_gen_N.dot
+struct OutputSettings {
+
+  // Image format to also render to through graphviz, empty for none
+  std::string render_format;
+
+  // Heatmap of the reordered matrix, ppm or svg, empty for none
+  std::string heatmap_format;
+
+  // Largest width and height of a heatmap in pixels
+  unsigned int heatmap_size;
+
+  // Write the matrix reordered, as best_gen_N.csv and best_gen_N.perm
+  bool reordered;
+
+  // Write best_gen_N.dot
+  bool dot;
+
+  // Append snapshots to this trajectory log, empty for none
+  std::string trajectory;
+};
+
+// Layout of one specimen at one generation, cheap to hand between threads
+struct Snapshot {
+  int n_generation;
+  unsigned int score;
+  std::vector<Pos> genome;
+
+  // Written under --on_improvement for beating the last snapshot, so it is
+  // never dropped
+  bool improved = false;
+};
+
+// Append only JSON lines log of how the best layout changes. A "graph"
+// record holds the size, edges and labels of the graph, and each snapshot
+// after it lists only the nodes which moved since the snapshot before, as
+// [index in genome(), x, y]. Runs appending to an existing log start again
+// with a graph record. Expanded back into dot files by autograph_frames.
+// Records are only formatted into out here, the SnapshotWriter writes them.
+struct TrajectoryLog {
+  TextBuffer out;
+
+  // Genome of the last snapshot logged
+  std::vector<Pos> last;
+
+  TrajectoryLog(Bipartate &graph);
+  void append(const Snapshot &s);
+};
+
+void append_json_string(TextBuffer &out, std::string_view text) {
+  out << '"';
+  for (char ch : text) {
+    if (ch == '"' || ch == '\\') {
+      out << '\\' << ch;
+    } else if (static_cast<unsigned char>(ch) < 0x20) {
+      out << ' ';
+    } else {
+      out << ch;
+    }
+  }
+  out << '"';
+}
+
+TrajectoryLog::TrajectoryLog(Bipartate &graph) {
+  out << "{\"graph\":{\"t1\":" << graph.t1.size()
+      << ",\"t2\":" << graph.t2.size() << ",\"edges\":[";
+  for (unsigned int i = 0; i < graph.edges.size(); i++) {
+    Edge &e = graph.edges[i];
+    out << (i ? ",[" : "[") << e.from << ',' << e.to << ',' << e.weight << ']';
+  }
+  out << ']';
+
+  if (graph.labels) {
+    for (bool c : {true, false}) {
+      out << (c ? ",\"t1_labels\":[" : ",\"t2_labels\":[");
+      for (unsigned int id = 0; id < graph(c).size(); id++) {
+        unsigned int label = graph(c)[id].label;
+        if (id) {
+          out << ',';
+        }
+        append_json_string(out,
+                           label == no_label ? "" : (*graph.labels)[label]);
+      }
+      out << ']';
+    }
+  }
+  out << "}}\n";
+}
+
+void TrajectoryLog::append(const Snapshot &s) {
+  out << "{\"gen\":" << s.n_generation << ",\"score\":" << s.score
+      << ",\"moved\":[";
+  bool first = true;
+  for (unsigned int i = 0; i < s.genome.size(); i++) {
+    Pos p = s.genome[i];
+    if (i < last.size() && last[i].x == p.x && last[i].y == p.y) {
+      continue;
+    }
+    out << (first ? "[" : ",[") << i << ',' << p.x << ',' << p.y << ']';
+    first = false;
+  }
+  out << "]}\n";
+  last = s.genome;
+}
+
+// Writes best_gen_N.dot files on a thread of its own, so that evolving never
+// waits for the disk. At most capacity snapshots wait to be written; when
+// the writer falls behind the oldest waiting snapshot is dropped, unless
+// it is an improvement, which waits however many there are. Trajectory
+// records come formatted with every snapshot pushed and are always written,
+// dropped snapshot or not.
+struct SnapshotWriter {
+
+  // Copy of the graph which snapshots are laid out on before writing
+  Bipartate canvas;
+
+  // Files to write besides best_gen_N.dot
+  OutputSettings settings;
+
+  // Trajectory records not yet written, and the log, opened on first use
+  std::string records;
+  std::ofstream trajectory;
+
+  std::deque<Snapshot> queue;
+  size_t capacity;
+  unsigned int n_dropped;
+  bool done;
+  std::mutex m;
+  std::condition_variable cv;
+  std::thread worker;
+
+  SnapshotWriter(const Bipartate &graph, OutputSettings settings,
+                 size_t capacity = 2);
+  ~SnapshotWriter();
+  void push(Snapshot s, std::string_view record = {});
+  void run();
+  void write(const Snapshot &s, GVC_t *gvc);
+};
+
+SnapshotWriter::SnapshotWriter(const Bipartate &graph,
+                               OutputSettings settings, size_t capacity)
+    : canvas(graph), settings(settings), capacity(capacity) {
+  n_dropped = 0;
+  done = false;
+  worker = std::thread(&SnapshotWriter::run, this);
+}
+
+// Write whatever is still waiting, then stop
+SnapshotWriter::~SnapshotWriter() {
+  {
+    std::lock_guard<std::mutex> lock(m);
+    done = true;
+  }
+  cv.notify_one();
+  worker.join();
+  if (n_dropped) {
+    std::cout << "Dropped " << n_dropped << " snapshots while writing";
+    std::cout << std::endl;
+  }
+}
+
+void SnapshotWriter::push(Snapshot s, std::string_view record) {
+  {
+    std::lock_guard<std::mutex> lock(m);
+    records += record;
+    if (queue.size() >= capacity) {
+      auto oldest = std::find_if(queue.begin(), queue.end(),
+                                 [](Snapshot &q) { return !q.improved; });
+      if (oldest != queue.end()) {
+        queue.erase(oldest);
+        n_dropped++;
+      }
+    }
+    queue.push_back(std::move(s));
+  }
+  cv.notify_one();
+}
+
+void SnapshotWriter::run() {
+  AUTOGRAPH_TRACE_THREAD("snapshots");
+
+  // libgvc is not thread safe, so it is only ever used from this thread
+  GVC_t *gvc = settings.render_format.empty() ? nullptr : gvContext();
+
+  std::unique_lock<std::mutex> lock(m);
+  while (true) {
+    cv.wait(lock,
+            [this] { return done || !queue.empty() || !records.empty(); });
+    if (queue.empty() && records.empty()) {
+      break;
+    }
+    std::string text;
+    text.swap(records);
+    std::optional<Snapshot> s;
+    if (!queue.empty()) {
+      s = std::move(queue.front());
+      queue.pop_front();
+    }
+
+    // Write without holding the lock, so push never waits on the disk
+    lock.unlock();
+    if (!text.empty()) {
+      if (!trajectory.is_open()) {
+        trajectory.open(settings.trajectory, std::ios::binary | std::ios::app);
+      }
+      trajectory.write(text.data(), text.size());
+      trajectory.flush();
+    }
+    if (s) {
+      write(*s, gvc);
+    }
+    lock.lock();
+  }
+
+  if (gvc) {
+    gvFreeContext(gvc);
+  }
+}
+
+// Write the files of one snapshot
+void SnapshotWriter::write(const Snapshot &s, GVC_t *gvc) {
+  canvas.set_genome(s.genome);
+  canvas.score = s.score;
+  std::string name = "best_gen_" + std::to_string(s.n_generation);
+  if (settings.dot) {
+    canvas.write_dot(name + ".dot");
+  }
+  if (gvc) {
+    canvas.render(gvc, name + "." + settings.render_format,
+                  settings.render_format);
+  }
+  if (!settings.heatmap_format.empty()) {
+
+    // Named apart, so an SVG render and an SVG heatmap do not collide
+    canvas.write_heatmap(name + ".heatmap." + settings.heatmap_format,
+                         settings.heatmap_size);
+  }
+  if (settings.reordered) {
+    canvas.write_reordered(name + ".csv", name + ".perm");
+  }
+}
+
+// Wall time of each phase of one generation
+struct PhaseTimes {
+  using Duration = std::chrono::duration<double, std::milli>;
+  Duration selection{0};
+  Duration mutation{0};
+  Duration scoring{0};
+  Duration sort{0};
+  Duration io{0};
+};
+
+// What one generation ended with, and how long it took
+struct TelemetryRecord {
+  int n_generation;
+  unsigned int n_specimen;
+  unsigned int best_score;
+  unsigned int median_score;
+  unsigned int worst_score;
+  double diversity;
+  PhaseTimes times;
+};
+
+// One record per generation, as CSV or, for names ending in .jsonl, as JSON
+// lines. Appends, so a resumed run carries on in the same file.
+struct Telemetry {
+  std::ofstream f;
+  bool json;
+
+  Telemetry(std::string file_name);
+  void append(const TelemetryRecord &r);
+};
+
+Telemetry::Telemetry(std::string file_name)
+    : json(file_name.ends_with(".jsonl")) {
+  bool empty =
+      std::ifstream(file_name).peek() == std::ifstream::traits_type::eof();
+  f.open(file_name, std::ios::app);
+  if (!f) {
+    std::cerr << "ERROR: Could not open " << file_name << std::endl;
+    std::exit(1);
+  }
+  f << std::fixed << std::setprecision(3);
+  if (empty && !json) {
+    f << "generation,n_specimen,best,median,worst,diversity,"
+         "selection_ms,mutation_ms,scoring_ms,sort_ms,io_ms\n";
+  }
+}
+
+void Telemetry::append(const TelemetryRecord &r) {
+  const PhaseTimes &t = r.times;
+  if (json) {
+    f << "{\"generation\":" << r.n_generation
+      << ",\"n_specimen\":" << r.n_specimen << ",\"best\":" << r.best_score
+      << ",\"median\":" << r.median_score << ",\"worst\":" << r.worst_score
+      << ",\"diversity\":" << r.diversity
+      << ",\"selection_ms\":" << t.selection.count()
+      << ",\"mutation_ms\":" << t.mutation.count()
+      << ",\"scoring_ms\":" << t.scoring.count()
+      << ",\"sort_ms\":" << t.sort.count() << ",\"io_ms\":" << t.io.count()
+      << "}\n";
+  } else {
+    f << r.n_generation << ',' << r.n_specimen << ',' << r.best_score << ','
+      << r.median_score << ',' << r.worst_score << ',' << r.diversity << ','
+      << t.selection.count() << ',' << t.mutation.count() << ','
+      << t.scoring.count() << ',' << t.sort.count() << ',' << t.io.count()
+      << '\n';
+  }
+
+  // Whole lines, so the file can be followed while the run goes on
+  f.flush();
+}
+
+// Defaults of the command line options, also used by Generations made
+// straight from a graph
+#define cli_n_specimen 1000
+#define cli_n_generations 1000
+#define cli_probability 50
+#define cli_output 100
+#define cli_threads 1
+#define cli_mutation_weights "1,1,1"
+#define cli_autotune_time 2.0
+#define cli_score_cache 65536
+#define cli_checkpoint 0
+#define cli_checkpoint_file "autograph.ckpt"
+#define cli_heatmap_size 2048
+#define cli_output_interval 0
+
+// Edge pair tests a scoring thread is given at the least, as fewer do not
+// repay waking it
+#define parallel_min_pair_tests (1 << 18)
+
+// Times a child is mutated again while its layout is already in the
+// population, before the slot is left empty
+#define duplicate_retries 3
+
+// Scores of layouts seen before, by layout hash. Each hash has one slot, so
+// a new layout pushes out whichever was there and the memory stays fixed.
+struct ScoreCache {
+  struct Slot {
+    uint64_t hash;
+    unsigned int score;
+    bool used;
+  };
+  std::vector<Slot> slots;
+
+  ScoreCache(unsigned int n_slots = 0);
+  bool find(uint64_t hash, unsigned int &score);
+  void insert(uint64_t hash, unsigned int score);
+};
+
+// Rounded up to a power of two, so a slot is picked by masking the hash
+ScoreCache::ScoreCache(unsigned int n_slots)
+    : slots(n_slots ? std::bit_ceil(n_slots) : 0) {}
+
+bool ScoreCache::find(uint64_t hash, unsigned int &score) {
+  if (slots.empty()) {
+    return false;
+  }
+  Slot &slot = slots[hash & (slots.size() - 1)];
+  if (!slot.used || slot.hash != hash) {
+    return false;
+  }
+  score = slot.score;
+  return true;
+}
+
+void ScoreCache::insert(uint64_t hash, unsigned int score) {
+  if (!slots.empty()) {
+    slots[hash & (slots.size() - 1)] = {hash, score, true};
+  }
+}
+
 struct Generation {
 
   // What generation we are on
@@ -327,10 +1229,35 @@ struct Generation {
   unsigned int default_n_gens;
   unsigned int default_n_specimen;
   unsigned int default_output;
+  unsigned int default_checkpoint;
+
+  // Threads children are scored on
+  unsigned int n_threads;
 
-  // All Graphs of this generation
+  // Odds of each kind of move when mutating
+  MutationWeights mutation_weights;
+
+  // Seconds each --autotune trial runs for, 0 to not tune
+  double autotune_time;
+
+  // Whether -s, -p and the weights are ones --autotune picked
+  bool autotuned;
+
+  // Past this evolve makes and scores no more children, for timed runs
+  std::chrono::steady_clock::time_point deadline;
+
+  // Adapt the mutation probability and weights to what has been working,
+  // starting from -p and --mutation_weights
+  bool adaptive;
+  double adaptive_chance;
+  std::array<double, n_mutation_types> move_rewards;
+
+  // All Graphs of this generation, no two with the same layout
   std::vector<Bipartate> specimen;
 
+  // Scores of earlier children, so a layout found again is not rescored
+  ScoreCache score_cache;
+
   // Scores of in this generation
   unsigned int worst_score;
   // double percentile_25; // 25th percentile
@@ -341,12 +1268,57 @@ struct Generation {
   // Name of CSV that this was initially created from
   std::string csv_name;
 
+  // Hash of that file's contents, checkpoints only resume on the same one
+  uint64_t source_hash;
+
+  // Where checkpoints are written to
+  std::string checkpoint_name;
+
+  // Files written with every snapshot besides best_gen_N.dot
+  OutputSettings output;
+
+  // Background writer of best_gen_N.dot files, started on first use
+  std::unique_ptr<SnapshotWriter> snapshots;
+
+  // Formats every snapshot for --trajectory, made on first use
+  std::unique_ptr<TrajectoryLog> trajectory;
+
+  // Threads children are scored on besides this one, kept between
+  // generations and started on first use
+  std::unique_ptr<WorkerPool> workers;
+
+  // Only write snapshots which improve on the last one written, or which
+  // differ from it after output_interval seconds (0: never)
+  bool output_on_improvement;
+  unsigned int output_interval;
+
+  // The last snapshot written
+  bool output_written;
+  unsigned int output_score;
+  uint64_t output_hash;
+  std::chrono::steady_clock::time_point output_time;
+
+  // Phase times of the last generation evolved
+  PhaseTimes phase_times;
+
+  // Per-generation records, if asked for
+  std::unique_ptr<Telemetry> telemetry;
+
   Generation(int argc, char **argv);
+  Generation(const Bipartate &initial);
   void evolve(unsigned int n_specimen, uint8_t chance);
   void write_dot(bool all);
+  bool snapshot_due();
+  void autotune(double seconds);
+  void adapt(unsigned int n_survivors, const std::vector<unsigned int> &parents,
+             const std::vector<MoveCounts> &moves);
+  double diversity();
+  void append_telemetry();
   void advance(unsigned int n_specimen, uint8_t chance);
   void advance_n_gens(unsigned int n_gens, unsigned int n_specimen,
                       uint8_t chance);
+  void write_checkpoint(std::string file_name);
+  void read_checkpoint(std::string file_name);
 };
 
 void Generation::advance(unsigned int n_specimen, uint8_t chance) {
@@ -359,25 +1331,71 @@ void Generation::advance(unsigned int n_specimen, uint8_t chance) {
 void Generation::advance_n_gens(unsigned int n_gens = 0,
                                 unsigned int n_specimen = 0,
                                 uint8_t chance = 0) {
+  handle_signals();
+
+  if (autotune_time) {
+    autotune(autotune_time);
+  }
 
+  // Last generation to evolve, resumed runs finish where the original would
+  unsigned int last = n_generation + n_gens;
   if (!n_gens || !n_specimen || !chance) {
-    n_gens = default_n_gens;
+    last = default_n_gens;
     n_specimen = default_n_specimen;
     chance = default_probability;
   }
 
-  for (unsigned int i = 0; i <= n_gens; i++) {
-    if (!(i % default_output)) {
-      std::cout << "Best score for Generation " << n_generation << ": ";
-      std::cout << specimen[0].score << std::endl;
-      write_dot(false);
+  while (static_cast<unsigned int>(n_generation) <= last) {
+    auto io_start = std::chrono::steady_clock::now();
+    if (!(n_generation % default_output)) {
+      std::cout << "Best score for Generation " + std::to_string(n_generation) +
+                       ": " + std::to_string(specimen[0].score) + "\n"
+                << std::flush;
+      if (adaptive) {
+        std::cout << "  mutation probability " << std::lround(adaptive_chance)
+                  << ", weights " << mutation_weights[0] << ","
+                  << mutation_weights[1] << "," << mutation_weights[2]
+                  << std::endl;
+      }
+      if (snapshot_due()) {
+        write_dot(false);
+      }
     }
+    PhaseTimes::Duration io = std::chrono::steady_clock::now() - io_start;
     evolve(n_specimen, chance);
+
+    io_start = std::chrono::steady_clock::now();
+    if (default_checkpoint && !(n_generation % default_checkpoint)) {
+      write_checkpoint(checkpoint_name);
+    }
+    phase_times.io = io + (std::chrono::steady_clock::now() - io_start);
+    if (telemetry) {
+      append_telemetry();
+    }
+
+    if (report_requested) {
+      report_requested = 0;
+      counters.print(std::cout);
+    }
+
+    // Pre-empted, save progress so the run can be resumed
+    if (stop_requested) {
+      std::cout << "Received SIGTERM at Generation " << n_generation;
+      std::cout << std::endl;
+      write_checkpoint(checkpoint_name);
+      break;
+    }
   }
+
+  // Wait for the last snapshots to reach the disk
+  snapshots.reset();
+  counters.print(std::cout);
 }
 
 Generation::Generation(int argc, char **argv) {
 
+  // Before the graph is loaded, so no phase of the run is left unprotected
+  handle_signals();
   n_generation = 0;
 
   // Create parser for arguments using argparse.
@@ -390,28 +1408,155 @@ Generation::Generation(int argc, char **argv) {
 
   // Optional argument
   arguments.add_argument("-s", "--n_specimen")
-      .default_value(static_cast<unsigned int>(1000))
+      .default_value(static_cast<unsigned int>(cli_n_specimen))
       .scan<'u', unsigned int>()
       .help("Integer: Number of specimen per generation");
 
   // Optional argument
   arguments.add_argument("-g", "--n_generations")
-      .default_value(static_cast<unsigned int>(1000))
+      .default_value(static_cast<unsigned int>(cli_n_generations))
       .scan<'u', unsigned int>()
       .help("Integer: Number of generations");
 
   // Optional argument
   arguments.add_argument("-p", "--probability")
-      .default_value(static_cast<unsigned int>(50))
+      .default_value(static_cast<unsigned int>(cli_probability))
       .scan<'u', unsigned int>()
       .help("Integer between 0 and 100: Proportion of mutations");
 
   // Optional argument
   arguments.add_argument("-o", "--output")
-      .default_value(static_cast<unsigned int>(100))
+      .default_value(static_cast<unsigned int>(cli_output))
       .scan<'u', unsigned int>()
       .help("Integer: Output best every n generations");
 
+  // Optional argument
+  arguments.add_argument("-t", "--threads")
+      .default_value(static_cast<unsigned int>(cli_threads))
+      .scan<'u', unsigned int>()
+      .help("Integer: Threads to score specimen on (0: one per core)");
+
+  // Optional argument
+  arguments.add_argument("--mutation_weights")
+      .default_value(std::string(cli_mutation_weights))
+      .action([](const std::string &text) {
+        parse_mutation_weights(text);
+        return text;
+      })
+      .help("a,b,c: Relative odds of vertical, horizontal and to front "
+            "moves");
+
+  // Optional argument
+  arguments.add_argument("--adaptive")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Adapt -p and --mutation_weights to what has been working");
+
+  // Optional argument
+  arguments.add_argument("--autotune")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Try variations of -s, -p and --mutation_weights on short runs, "
+            "-t at a time, then carry on with the fastest");
+
+  // Optional argument
+  arguments.add_argument("--autotune_time")
+      .default_value(cli_autotune_time)
+      .scan<'g', double>()
+      .help("Float: Seconds each autotune trial runs for");
+
+  // Optional argument
+  arguments.add_argument("--score_cache")
+      .default_value(static_cast<unsigned int>(cli_score_cache))
+      .scan<'u', unsigned int>()
+      .help("Integer: Layouts whose scores are remembered (0: none)");
+
+  // Optional argument
+  arguments.add_argument("-c", "--checkpoint")
+      .default_value(static_cast<unsigned int>(cli_checkpoint))
+      .scan<'u', unsigned int>()
+      .help("Integer: Checkpoint every n generations (0: only on SIGTERM)");
+
+  // Optional argument
+  arguments.add_argument("--checkpoint_file")
+      .default_value(std::string(cli_checkpoint_file))
+      .help("File path: Where checkpoints are written");
+
+  // Optional argument
+  arguments.add_argument("-r", "--render")
+      .default_value(std::string(""))
+      .action([](const std::string &format) {
+        if (format != "pdf" && format != "svg" && format != "png") {
+          throw std::runtime_error("--render must be pdf, svg or png");
+        }
+        return format;
+      })
+      .help("pdf, svg or png: Also render snapshots through graphviz");
+
+  // Optional argument
+  arguments.add_argument("--heatmap")
+      .default_value(std::string(""))
+      .action([](const std::string &format) {
+        if (format != "ppm" && format != "svg") {
+          throw std::runtime_error("--heatmap must be ppm or svg");
+        }
+        return format;
+      })
+      .help("ppm or svg: Also write snapshots as a heatmap of the matrix");
+
+  // Optional argument
+  arguments.add_argument("--heatmap_size")
+      .default_value(static_cast<unsigned int>(cli_heatmap_size))
+      .scan<'u', unsigned int>()
+      .help("Integer: Largest heatmap width and height, in pixels");
+
+  // Optional argument
+  arguments.add_argument("--on_improvement")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Only output the best when its score has improved");
+
+  // Optional argument
+  arguments.add_argument("--output_interval")
+      .default_value(static_cast<unsigned int>(cli_output_interval))
+      .scan<'u', unsigned int>()
+      .help("Integer: With --on_improvement, also output a changed best "
+            "after n seconds");
+
+  // Optional argument
+  arguments.add_argument("--reordered")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Also write snapshots as the reordered matrix and permutation");
+
+  // Optional argument
+  arguments.add_argument("--no_dot")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Do not write snapshots as dot files");
+
+  // Optional argument
+  arguments.add_argument("--trajectory")
+      .default_value(std::string(""))
+      .help("File path: Append snapshots to a trajectory log, see "
+            "autograph_frames");
+
+  // Optional argument
+  arguments.add_argument("--telemetry")
+      .default_value(std::string(""))
+      .help("File path: Append a record of every generation, as CSV or "
+            "JSON lines (.jsonl)");
+
+  // Optional argument
+  arguments.add_argument("--no_cache")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Do not read or write the binary graph cache (CSV.agc)");
+
+  // Optional argument
+  arguments.add_argument("--resume").help(
+      "File path: Checkpoint to continue evolving from");
+
   // Parse command line arguments
   try {
     arguments.parse_args(argc, argv);
@@ -437,35 +1582,129 @@ Generation::Generation(int argc, char **argv) {
   std::cout << std::endl;
   default_n_specimen = arguments.get<unsigned int>("-s");
   default_probability = arguments.get<unsigned int>("-p");
+  if (default_probability > 100) {
+    std::cerr << "ERROR: -p must be between 0 and 100!" << std::endl;
+    std::exit(1);
+  }
   default_n_gens = arguments.get<unsigned int>("-g");
   default_output = arguments.get<unsigned int>("-o");
+  default_checkpoint = arguments.get<unsigned int>("-c");
+  n_threads = arguments.get<unsigned int>("-t");
+  mutation_weights =
+      parse_mutation_weights(arguments.get<std::string>("--mutation_weights"));
+  autotune_time = arguments.get<bool>("--autotune")
+                      ? arguments.get<double>("--autotune_time")
+                      : 0;
+  autotuned = false;
+  deadline = std::chrono::steady_clock::time_point::max();
+  adaptive = arguments.get<bool>("--adaptive");
+  adaptive_chance = default_probability;
+  move_rewards = {};
+  score_cache = ScoreCache(arguments.get<unsigned int>("--score_cache"));
+  if (!n_threads) {
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  checkpoint_name = arguments.get<std::string>("--checkpoint_file");
+  output.render_format = arguments.get<std::string>("-r");
+  output.heatmap_format = arguments.get<std::string>("--heatmap");
+  output.heatmap_size = arguments.get<unsigned int>("--heatmap_size");
+  output.reordered = arguments.get<bool>("--reordered");
+  output.dot = !arguments.get<bool>("--no_dot");
+  output.trajectory = arguments.get<std::string>("--trajectory");
+  output_on_improvement = arguments.get<bool>("--on_improvement");
+  output_interval = arguments.get<unsigned int>("--output_interval");
+  output_written = false;
+  if (!arguments.get<std::string>("--telemetry").empty()) {
+    telemetry =
+        std::make_unique<Telemetry>(arguments.get<std::string>("--telemetry"));
+  }
 
   std::cout << "n_specimen: " << default_n_specimen << std::endl;
   std::cout << "n_generations: " << default_n_gens << std::endl;
   std::cout << "mutation probability: " << default_probability << std::endl;
   std::cout << "output every n generations: " << default_output << std::endl;
+  std::cout << "threads: " << n_threads << std::endl;
   std::cout << std::endl;
 
-  Bipartate b1(csv_name);
+  Bipartate b1;
+  try {
+    Topology topology =
+        load_topology(csv_name, !arguments.get<bool>("--no_cache"));
+    source_hash = topology.source_hash;
+    b1 = Bipartate(topology);
+  } catch (const std::runtime_error &err) {
+    std::cerr << "ERROR: " << csv_name << ": " << err.what() << std::endl;
+    std::exit(1);
+  }
+  b1.write_dot("input.dot");
   b1.calc_score();
   specimen.push_back(b1);
+  best_score = median_score = worst_score = b1.score;
   std::cout << "number of nodes: ";
   std::cout << std::to_string(b1.t1.size() + b1.t2.size()) << std::endl;
   std::cout << "number of edges: " << std::to_string(b1.edges.size());
   std::cout << std::endl;
   std::cout << "Score for Generation 0: " << b1.score << std::endl;
   std::cout << std::endl;
+
+  // Continue from the population of an earlier run
+  if (arguments.is_used("--resume")) {
+    read_checkpoint(arguments.get<std::string>("--resume"));
+    std::cout << "Resumed at Generation " << n_generation;
+    std::cout << " with best score ";
+    std::cout << specimen[0].score << std::endl;
+    std::cout << std::endl;
+  }
+}
+
+// Start from a graph directly, with the command line's defaults
+Generation::Generation(const Bipartate &initial) {
+  n_generation = 0;
+  source_hash = 0;
+  default_n_specimen = cli_n_specimen;
+  default_n_gens = cli_n_generations;
+  default_probability = cli_probability;
+  default_output = cli_output;
+  default_checkpoint = cli_checkpoint;
+  n_threads = cli_threads;
+  mutation_weights = parse_mutation_weights(cli_mutation_weights);
+
+  // Tuning is left to the caller
+  autotune_time = 0;
+  autotuned = false;
+  deadline = std::chrono::steady_clock::time_point::max();
+  adaptive = false;
+  adaptive_chance = default_probability;
+  move_rewards = {};
+  score_cache = ScoreCache(cli_score_cache);
+  checkpoint_name = cli_checkpoint_file;
+  output = {.render_format = "",
+            .heatmap_format = "",
+            .heatmap_size = cli_heatmap_size,
+            .reordered = false,
+            .dot = true,
+            .trajectory = ""};
+  output_on_improvement = false;
+  output_interval = cli_output_interval;
+  output_written = false;
+
+  specimen.push_back(initial);
+  specimen[0].calc_score();
+  best_score = median_score = worst_score = specimen[0].score;
 }
 
 void Generation::evolve(unsigned int n_specimen, uint8_t chance) {
+  AUTOGRAPH_TRACE_SCOPE("evolve");
+  auto start = std::chrono::steady_clock::now();
 
   // Killing by chance
   unsigned int n_size = specimen.size();
 
   std::vector<Bipartate> specimen_copy;
 
+  // The best always survives, so the population is never emptied
   for (unsigned int i = 0; i < n_size; i++) {
-    if (i < Random::get<uint8_t>(1, n_size)) {
+    if (!i || i < Random::get<unsigned int>(1, n_size)) {
       specimen_copy.push_back(specimen[i]);
     }
   }
@@ -475,19 +1714,365 @@ void Generation::evolve(unsigned int n_specimen, uint8_t chance) {
   specimen = specimen_copy;
   specimen_copy.clear();
 
-  unsigned int i = 0;
-  n_size = specimen.size();
-  while (n_size < n_specimen) {
-    specimen.push_back(specimen[i].mutate(chance));
-    i++;
-    n_size++;
+  auto selected = std::chrono::steady_clock::now();
+  phase_times.selection = selected - start;
+
+  if (adaptive) {
+    chance = std::lround(adaptive_chance);
+  }
+
+  // Mutate first and score after, so each is timed on its own. The child
+  // at n_survivors + j is made from specimen[parents[j]]. A child with a
+  // layout already in the population is mutated again instead of kept.
+  unsigned int n_survivors = specimen.size();
+  std::unordered_set<uint64_t> layouts;
+  for (Bipartate &b : specimen) {
+    layouts.insert(b.genome_hash());
+  }
+  std::vector<unsigned int> parents;
+  std::vector<MoveCounts> moves;
+  uint64_t n_rejected = 0;
+  for (unsigned int i = 0; n_survivors + i < n_specimen &&
+                          std::chrono::steady_clock::now() < deadline;
+       i++) {
+    unsigned int parent = i % specimen.size();
+    MoveCounts counts{};
+    for (unsigned int tries = 0; tries <= duplicate_retries; tries++) {
+      Bipartate child = specimen[parent].mutate(
+          chance, false, mutation_weights, adaptive ? &counts : nullptr);
+      if (layouts.insert(child.genome_hash()).second) {
+        specimen.push_back(std::move(child));
+        parents.push_back(parent);
+        if (adaptive) {
+          moves.push_back(counts);
+        }
+        break;
+      }
+      n_rejected++;
+    }
+  }
+  counters.add(counters.duplicates_rejected, n_rejected);
+  auto mutated = std::chrono::steady_clock::now();
+  phase_times.mutation = mutated - selected;
+
+  // Children seen in earlier generations take their score from the cache.
+  // The rest are scored in parallel, but mutated on this thread alone, so a
+  // run is the same whatever the number of threads.
+  std::vector<unsigned int> unscored;
+  for (unsigned int j = n_survivors; j < specimen.size(); j++) {
+    if (!score_cache.find(specimen[j].genome_hash(), specimen[j].score)) {
+      unscored.push_back(j);
+    }
+  }
+  counters.add(counters.score_cache_hits,
+               specimen.size() - n_survivors - unscored.size());
+  // Each worker is given enough edge pairs to be worth waking
+  uint64_t n_edges = specimen[0].edges.size();
+  uint64_t n_tests = unscored.size() * (n_edges * n_edges / 2);
+  unsigned int n_workers = std::clamp<uint64_t>(
+      n_tests / parallel_min_pair_tests, 1,
+      std::min<uint64_t>(n_threads, std::max<size_t>(unscored.size(), 1)));
+  if (n_workers > 1 && !workers) {
+    workers = std::make_unique<WorkerPool>();
+  }
+  std::vector<char> has_score(unscored.size(), false);
+  auto score = [&](unsigned int t) {
+    for (size_t k = t; k < unscored.size(); k += n_workers) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        break;
+      }
+      specimen[unscored[k]].calc_score();
+      has_score[k] = true;
+    }
+  };
+  if (n_workers > 1) {
+    workers->run(n_workers, score);
+  } else {
+    score(0);
+  }
+  for (size_t k = 0; k < unscored.size(); k++) {
+    if (has_score[k]) {
+      score_cache.insert(specimen[unscored[k]].genome_hash(),
+                         specimen[unscored[k]].score);
+    }
   }
+
+  // Children the deadline left unscored are dropped, with what made them
+  if (std::find(has_score.begin(), has_score.end(), false) !=
+      has_score.end()) {
+    std::vector<char> keep(specimen.size(), true);
+    for (size_t k = 0; k < unscored.size(); k++) {
+      keep[unscored[k]] = has_score[k];
+    }
+    unsigned int n_kept = n_survivors;
+    for (unsigned int j = n_survivors; j < specimen.size(); j++) {
+      if (keep[j]) {
+        specimen[n_kept] = std::move(specimen[j]);
+        parents[n_kept - n_survivors] = parents[j - n_survivors];
+        if (adaptive) {
+          moves[n_kept - n_survivors] = moves[j - n_survivors];
+        }
+        n_kept++;
+      }
+    }
+    specimen.erase(specimen.begin() + n_kept, specimen.end());
+    parents.resize(n_kept - n_survivors);
+    if (adaptive) {
+      moves.resize(n_kept - n_survivors);
+    }
+  }
+  if (adaptive) {
+    adapt(n_survivors, parents, moves);
+  }
+  auto scored = std::chrono::steady_clock::now();
+  phase_times.scoring = scored - mutated;
+
   std::sort(specimen.begin(), specimen.end());
+  phase_times.sort = std::chrono::steady_clock::now() - scored;
+
+  best_score = specimen.front().score;
+  median_score = specimen[specimen.size() / 2].score;
+  worst_score = specimen.back().score;
   n_generation++;
 }
 
+// Rate by the 1/5 success rule: mutate more while over a fifth of children
+// beat their parent, less while fewer do. Weights by credit assignment: each
+// child's gain is shared among the kinds of move it made, and every kind is
+// then picked in proportion to its recent mean gain per move, never less
+// than a tenth of the time.
+void Generation::adapt(unsigned int n_survivors,
+                       const std::vector<unsigned int> &parents,
+                       const std::vector<MoveCounts> &moves) {
+  unsigned int n_children = specimen.size() - n_survivors;
+  unsigned int n_improved = 0;
+  std::array<double, n_mutation_types> gain{};
+  std::array<double, n_mutation_types> used{};
+  for (unsigned int j = 0; j < n_children; j++) {
+    unsigned int parent = specimen[parents[j]].score;
+    unsigned int child = specimen[n_survivors + j].score;
+    n_improved += child < parent;
+    unsigned int n_moves =
+        std::accumulate(moves[j].begin(), moves[j].end(), 0u);
+    for (unsigned int t = 0; t < n_mutation_types && n_moves; t++) {
+      double share = double(moves[j][t]) / n_moves;
+      used[t] += share;
+      gain[t] += child < parent ? share * (parent - child) : 0;
+    }
+  }
+
+  double success = n_children ? double(n_improved) / n_children : 0.2;
+  if (success != 0.2) {
+    adaptive_chance *= success > 0.2 ? 1.22 : 1 / 1.22;
+  }
+  adaptive_chance = std::clamp(adaptive_chance, 2.0, 100.0);
+
+  double total = 0;
+  for (unsigned int t = 0; t < n_mutation_types; t++) {
+    if (used[t] > 0) {
+      move_rewards[t] = 0.8 * move_rewards[t] + 0.2 * gain[t] / used[t];
+    }
+    total += move_rewards[t];
+  }
+  if (total > 0) {
+    const double floor = 0.1;
+    for (unsigned int t = 0; t < n_mutation_types; t++) {
+      mutation_weights[t] = std::lround(
+          1000 * (floor + (1 - n_mutation_types * floor) * move_rewards[t] /
+                              total));
+    }
+  }
+}
+
+// A setting tried by --autotune, and how fast it removed crossings
+struct Trial {
+  unsigned int n_specimen;
+  unsigned int probability;
+  MutationWeights weights;
+  double rate;
+  Bipartate best;
+};
+
+// Evolve start for seconds with every trial's setting, n_threads trials at
+// a time. Trials run on threads of their own, each trial with the thread's
+// random engine seeded from the calling thread's, which is left as it was.
+void run_trials(const Bipartate &start, std::vector<Trial> &trials,
+                double seconds, unsigned int n_threads) {
+  unsigned int seed = Random::get<unsigned int>();
+  std::atomic<unsigned int> next{0};
+  auto run = [&] {
+    for (unsigned int i; (i = next++) < trials.size();) {
+      Trial &t = trials[i];
+      Random::seed(seed + i);
+      Generation g(start);
+      g.mutation_weights = t.weights;
+      auto begin = std::chrono::steady_clock::now();
+
+      // A generation is cut short at the deadline, however large it is
+      g.deadline = begin + std::chrono::duration_cast<
+                               std::chrono::steady_clock::duration>(
+                               std::chrono::duration<double>(seconds));
+      std::chrono::duration<double> elapsed;
+      do {
+        g.evolve(t.n_specimen, t.probability);
+        elapsed = std::chrono::steady_clock::now() - begin;
+      } while (elapsed.count() < seconds && g.best_score && !stop_requested);
+      t.rate = (start.score - g.best_score) / elapsed.count();
+      t.best = g.specimen[0];
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0;
+       i < std::clamp<unsigned int>(trials.size(), 1, n_threads); i++) {
+    threads.emplace_back(run);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// Pick -s and -p from a grid around the current ones, then the odds of each
+// kind of move, by how fast short runs from the best specimen improve it.
+// The best layout any trial found joins the population.
+void Generation::autotune(double seconds) {
+  std::cout << "Autotuning from score " << specimen[0].score << std::endl;
+  unsigned int s = default_n_specimen;
+  unsigned int p = default_probability;
+  std::vector<Trial> trials;
+  for (unsigned int ts : {std::max(2u, s / 4), s, s * 4}) {
+    for (unsigned int tp : {std::max(2u, p / 4), p, std::min(100u, p * 2)}) {
+      if (std::none_of(trials.begin(), trials.end(), [&](Trial &t) {
+            return t.n_specimen == ts && t.probability == tp;
+          })) {
+        trials.push_back({ts, tp, mutation_weights, 0, {}});
+      }
+    }
+  }
+
+  // Each stage is judged on its own, the second repeats the first's winner
+  Trial best{s, p, mutation_weights, 0, {}};
+  Bipartate best_layout = specimen[0];
+  for (bool weights : {false, true}) {
+    if (weights) {
+      trials.clear();
+      for (MutationWeights w : std::vector<MutationWeights>{
+               mutation_weights, {4, 1, 1}, {1, 4, 1}, {1, 1, 4}}) {
+        trials.push_back({best.n_specimen, best.probability, w, 0, {}});
+      }
+    }
+    run_trials(specimen[0], trials, seconds, n_threads);
+    if (report_requested) {
+      report_requested = 0;
+      counters.print(std::cout);
+    }
+
+    // Cut short by SIGTERM, the run checkpoints with the settings it had
+    if (stop_requested) {
+      std::cout << "Autotuning stopped" << std::endl;
+      return;
+    }
+    best = trials[0];
+    for (Trial &t : trials) {
+      std::cout << "  -s " << t.n_specimen << " -p " << t.probability
+                << " --mutation_weights " << t.weights[0] << ","
+                << t.weights[1] << "," << t.weights[2] << ": " << std::fixed
+                << std::setprecision(1) << t.rate << " crossings/s"
+                << std::endl;
+      best = t.rate > best.rate ? t : best;
+      if (t.best.score < best_layout.score) {
+        best_layout = t.best;
+      }
+    }
+  }
+
+  default_n_specimen = best.n_specimen;
+  default_probability = best.probability;
+  mutation_weights = best.weights;
+  adaptive_chance = default_probability;
+  autotuned = true;
+  std::cout << "Autotuned to -s " << default_n_specimen << " -p "
+            << default_probability << " --mutation_weights "
+            << mutation_weights[0] << "," << mutation_weights[1] << ","
+            << mutation_weights[2] << std::endl;
+  std::cout << std::endl;
+
+  if (best_layout.genome_hash() != specimen[0].genome_hash()) {
+    specimen.push_back(best_layout);
+    std::sort(specimen.begin(), specimen.end());
+  }
+}
+
+// Mean share of nodes each specimen places elsewhere than the best does,
+// 0 when the population has converged on one layout
+double Generation::diversity() {
+  std::vector<Pos> best = specimen[0].genome();
+  if (best.empty() || specimen.size() < 2) {
+    return 0;
+  }
+  uint64_t n_moved = 0;
+  for (unsigned int i = 1; i < specimen.size(); i++) {
+    std::vector<Pos> g = specimen[i].genome();
+    for (size_t k = 0; k < g.size(); k++) {
+      n_moved += g[k].x != best[k].x || g[k].y != best[k].y;
+    }
+  }
+  return double(n_moved) / (best.size() * (specimen.size() - 1));
+}
+
+void Generation::append_telemetry() {
+  telemetry->append({n_generation, static_cast<unsigned int>(specimen.size()),
+                     best_score, median_score, worst_score, diversity(),
+                     phase_times});
+}
+
+// Whether the best specimen should be written under the output policy
+bool Generation::snapshot_due() {
+  if (!output_on_improvement || !output_written) {
+    return true;
+  }
+
+  // Same layout as last time, nothing new to write
+  if (specimen[0].genome_hash() == output_hash) {
+    return false;
+  }
+  if (specimen[0].score < output_score) {
+    return true;
+  }
+  return output_interval && std::chrono::steady_clock::now() - output_time >=
+                                std::chrono::seconds(output_interval);
+}
+
 void Generation::write_dot(bool all) {
-  specimen[0].write_dot("best_gen_" + std::to_string(n_generation) + ".dot");
+
+  // The output policy counts this as written, so it must not be dropped
+  bool improved = output_on_improvement &&
+                  (!output_written || specimen[0].score < output_score);
+  output_written = true;
+  output_score = specimen[0].score;
+  output_time = std::chrono::steady_clock::now();
+  if (output_on_improvement) {
+    output_hash = specimen[0].genome_hash();
+  }
+
+  Snapshot s{n_generation, specimen[0].score, specimen[0].genome(),
+             improved};
+
+  // Formatted on this thread, as the writer may drop snapshots when behind,
+  // and written on the writer's
+  if (!output.trajectory.empty() && !trajectory) {
+    trajectory = std::make_unique<TrajectoryLog>(specimen[0]);
+  }
+  if (trajectory) {
+    trajectory->append(s);
+  }
+
+  if (!snapshots) {
+    snapshots = std::make_unique<SnapshotWriter>(specimen[0], output);
+  }
+  snapshots->push(std::move(s), trajectory ? trajectory->out.view() : "");
+  if (trajectory) {
+    trajectory->out.clear();
+  }
 
   if (all) {
     for (unsigned int i = 1; i < specimen.size(); ++i) {
@@ -495,3 +2080,228 @@ void Generation::write_dot(bool all) {
     }
   }
 }
+
+// Checkpoint layout, all integers native endian:
+//   "AGCK", version, n_generation, n_t1, n_t2, n_edges, 64 bit source hash,
+//   RNG state length and text, flags (1: autotuned, 2: adaptive), -s, -p,
+//   the three mutation weights, then as doubles the adaptive probability
+//   and the three move rewards, number of specimen,
+//   then per specimen its score, (x, y) of every node as in genome(), and
+//   the number of cells in positions followed by (x, y, id) of each.
+// Cells a node has left stay in positions and steer later moves, so they
+// are kept for a resumed run to evolve exactly as the original would have.
+#define checkpoint_magic "AGCK"
+#define checkpoint_version 4
+#define checkpoint_autotuned 1
+#define checkpoint_adaptive 2
+
+// Longest RNG state read back, mt19937's text is under 7 kB
+#define checkpoint_max_rng_state 65536
+
+template <typename T> void write_raw(std::ofstream &f, T value) {
+  f.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T read_raw(std::ifstream &f) {
+  T value{};
+  f.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return value;
+}
+
+void Generation::write_checkpoint(std::string file_name) {
+  AUTOGRAPH_TRACE_SCOPE("write_checkpoint");
+
+  // Write next to the old checkpoint and swap, so a kill mid-write never
+  // leaves a truncated file behind
+  std::string tmp_name = file_name + ".tmp";
+  std::ofstream f(tmp_name, std::ios::binary);
+  std::cout << "Writing " << file_name << std::endl;
+
+  std::ostringstream rng;
+  Random::serialize(rng);
+  std::string rng_state = rng.str();
+
+  f.write(checkpoint_magic, 4);
+  write_raw<uint32_t>(f, checkpoint_version);
+  write_raw<uint32_t>(f, n_generation);
+  write_raw<uint32_t>(f, specimen[0].t1.size());
+  write_raw<uint32_t>(f, specimen[0].t2.size());
+  write_raw<uint32_t>(f, specimen[0].edges.size());
+  write_raw<uint64_t>(f, source_hash);
+  write_raw<uint32_t>(f, rng_state.size());
+  f.write(rng_state.data(), rng_state.size());
+
+  // Settings tuning and adapting arrived at, so a resumed run keeps them
+  write_raw<uint32_t>(f, (autotuned ? checkpoint_autotuned : 0) |
+                             (adaptive ? checkpoint_adaptive : 0));
+  write_raw<uint32_t>(f, default_n_specimen);
+  write_raw<uint32_t>(f, default_probability);
+  for (unsigned int w : mutation_weights) {
+    write_raw<uint32_t>(f, w);
+  }
+  write_raw<double>(f, adaptive_chance);
+  for (double r : move_rewards) {
+    write_raw<double>(f, r);
+  }
+
+  write_raw<uint32_t>(f, specimen.size());
+  for (auto &b : specimen) {
+    write_raw<uint32_t>(f, b.score);
+    for (Pos p : b.genome()) {
+      write_raw<int32_t>(f, p.x);
+      write_raw<int32_t>(f, p.y);
+    }
+    write_raw<uint32_t>(f, b.positions.size());
+    for (auto &[cell, id] : b.positions) {
+      write_raw<int32_t>(f, cell.first);
+      write_raw<int32_t>(f, cell.second);
+      write_raw<uint32_t>(f, id);
+    }
+  }
+  f.close();
+
+  if (!f || std::rename(tmp_name.c_str(), file_name.c_str())) {
+    std::cerr << "ERROR: Could not write checkpoint " << file_name;
+    std::cerr << std::endl;
+  }
+}
+
+void Generation::read_checkpoint(std::string file_name) {
+  std::ifstream f(file_name, std::ios::binary | std::ios::ate);
+  uint64_t file_size = f ? static_cast<uint64_t>(f.tellg()) : 0;
+  f.seekg(0);
+  char magic[4] = {};
+  f.read(magic, 4);
+  if (!f || std::string(magic, 4) != checkpoint_magic ||
+      read_raw<uint32_t>(f) != checkpoint_version) {
+    std::cerr << "ERROR: " << file_name << " is not a checkpoint!";
+    std::cerr << std::endl;
+    std::exit(1);
+  }
+
+  unsigned int generation = read_raw<uint32_t>(f);
+
+  // Genomes only make sense for the graph they were evolved on
+  Bipartate base = specimen[0];
+  unsigned int n_t1 = read_raw<uint32_t>(f);
+  unsigned int n_t2 = read_raw<uint32_t>(f);
+  unsigned int n_edges = read_raw<uint32_t>(f);
+  uint64_t hash = read_raw<uint64_t>(f);
+  if (n_t1 != base.t1.size() || n_t2 != base.t2.size() ||
+      n_edges != base.edges.size() || hash != source_hash) {
+    std::cerr << "ERROR: Checkpoint " << file_name << " was not made from ";
+    std::cerr << csv_name << "!" << std::endl;
+    std::exit(1);
+  }
+
+  // Lengths are checked against the file before anything is allocated
+  uint32_t rng_size = read_raw<uint32_t>(f);
+  if (!f || rng_size > checkpoint_max_rng_state) {
+    std::cerr << "ERROR: Checkpoint " << file_name << " is damaged!";
+    std::cerr << std::endl;
+    std::exit(1);
+  }
+  std::string rng_state(rng_size, '\0');
+  f.read(rng_state.data(), rng_state.size());
+
+  unsigned int flags = read_raw<uint32_t>(f);
+  unsigned int tuned_n_specimen = read_raw<uint32_t>(f);
+  unsigned int tuned_probability = read_raw<uint32_t>(f);
+  MutationWeights weights;
+  for (unsigned int &w : weights) {
+    w = read_raw<uint32_t>(f);
+  }
+  double chance = read_raw<double>(f);
+  std::array<double, n_mutation_types> rewards;
+  for (double &r : rewards) {
+    r = read_raw<double>(f);
+  }
+  bool bad_tuning = (flags & checkpoint_autotuned) &&
+                    (!tuned_n_specimen || !tuned_probability ||
+                     tuned_probability > 100);
+  bool bad_adapting = (flags & checkpoint_adaptive) &&
+                      !(chance >= 2 && chance <= 100);
+  if (f && (bad_tuning || bad_adapting ||
+            std::all_of(weights.begin(), weights.end(),
+                        [](unsigned int w) { return !w; }))) {
+    std::cerr << "ERROR: Checkpoint " << file_name << " is damaged!";
+    std::cerr << std::endl;
+    std::exit(1);
+  }
+
+  unsigned int n_specimen = read_raw<uint32_t>(f);
+  uint64_t specimen_size = 4 + 8 * (uint64_t(n_t1) + n_t2) + 4;
+  uint64_t left = f ? file_size - static_cast<uint64_t>(f.tellg()) : 0;
+  if (!f || n_specimen * specimen_size > left) {
+    std::cerr << "ERROR: Checkpoint " << file_name << " is truncated!";
+    std::cerr << std::endl;
+    std::exit(1);
+  }
+  std::vector<Bipartate> restored;
+  std::vector<Pos> g(n_t1 + n_t2);
+  for (unsigned int i = 0; i < n_specimen && f; ++i) {
+    unsigned int score = read_raw<uint32_t>(f);
+    for (Pos &p : g) {
+      p.x = read_raw<int32_t>(f);
+      p.y = read_raw<int32_t>(f);
+    }
+    restored.push_back(base);
+    Bipartate &b = restored.back();
+    b.set_genome(g);
+    b.score = score;
+
+    // Columns alternate between t1 and t2, so x says which ids a cell holds
+    uint32_t n_cells = read_raw<uint32_t>(f);
+    left = f ? file_size - static_cast<uint64_t>(f.tellg()) : 0;
+    if (!f || uint64_t(n_cells) * 12 > left) {
+      std::cerr << "ERROR: Checkpoint " << file_name << " is truncated!";
+      std::cerr << std::endl;
+      std::exit(1);
+    }
+    b.positions.clear();
+    for (uint32_t k = 0; k < n_cells && f; ++k) {
+      int x = read_raw<int32_t>(f);
+      int y = read_raw<int32_t>(f);
+      unsigned int id = read_raw<uint32_t>(f);
+      if (id >= (x & 1 ? n_t2 : n_t1)) {
+        std::cerr << "ERROR: Checkpoint " << file_name << " is damaged!";
+        std::cerr << std::endl;
+        std::exit(1);
+      }
+      b.positions[{x, y}] = id;
+    }
+  }
+
+  if (!f || restored.empty()) {
+    std::cerr << "ERROR: Checkpoint " << file_name << " is truncated!";
+    std::cerr << std::endl;
+    std::exit(1);
+  }
+
+  std::istringstream rng(rng_state);
+  Random::deserialize(rng);
+  if (!rng) {
+    std::cerr << "ERROR: Checkpoint " << file_name;
+    std::cerr << " was written with another random engine!" << std::endl;
+    std::exit(1);
+  }
+  n_generation = generation;
+  specimen = restored;
+
+  // Tuned settings replace the command line's, and tuning is not repeated
+  if (flags & checkpoint_autotuned) {
+    default_n_specimen = tuned_n_specimen;
+    default_probability = tuned_probability;
+    mutation_weights = weights;
+    adaptive_chance = default_probability;
+    autotune_time = 0;
+    autotuned = true;
+  }
+
+  // Adapting carries on from where it had got to
+  if (adaptive && (flags & checkpoint_adaptive)) {
+    mutation_weights = weights;
+    adaptive_chance = chance;
+    move_rewards = rewards;
+  }
+}
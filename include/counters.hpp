@@ -0,0 +1,106 @@
+#pragma once
+
+// Always-on counts of the work done, cheap enough to leave in production
+// builds, for comparing configurations without a profiler. Updated with
+// relaxed atomics, at most a few times per call of the code counted.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <sys/resource.h>
+
+// Kinds of move made by Bipartate::mutate
+#define n_mutation_types 3
+inline const char *mutation_names[n_mutation_types] = {
+    "vertical", "horizontal", "to front"};
+
+struct Counters {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::atomic<uint64_t> score_calls{0};
+  std::atomic<uint64_t> edge_pair_tests{0};
+  std::atomic<uint64_t> specimens_copied{0};
+
+  // Children given a score already known for their layout, and children
+  // thrown away for having the layout of another specimen
+  std::atomic<uint64_t> score_cache_hits{0};
+  std::atomic<uint64_t> duplicates_rejected{0};
+
+  // Moves picked, and those that moved a node, by kind
+  std::atomic<uint64_t> mutations_attempted[n_mutation_types] = {};
+  std::atomic<uint64_t> mutations_applied[n_mutation_types] = {};
+
+  void add(std::atomic<uint64_t> &counter, uint64_t n) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+  }
+  void print(std::ostream &out);
+};
+
+inline Counters counters;
+
+// Set by the SIGUSR1 handler, the counters are printed between generations
+inline volatile std::sig_atomic_t report_requested = 0;
+
+void request_report(int) { report_requested = 1; }
+
+// Largest resident set so far, in bytes
+uint64_t peak_rss() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void Counters::print(std::ostream &out) {
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  uint64_t calls = score_calls.load(std::memory_order_relaxed);
+  uint64_t tests = edge_pair_tests.load(std::memory_order_relaxed);
+
+  // Built up first and written at once, so it is not split by other output
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(1);
+  s << "Counters after " << seconds << " s\n";
+  s << "  score calculations: " << calls << " (" << calls / seconds
+    << "/s)\n";
+  s << "  edge pair tests: " << tests << " (" << tests / seconds << "/s)\n";
+  s << "  specimens copied: "
+    << specimens_copied.load(std::memory_order_relaxed) << "\n";
+  s << "  score cache hits: "
+    << score_cache_hits.load(std::memory_order_relaxed) << "\n";
+  s << "  duplicate layouts rejected: "
+    << duplicates_rejected.load(std::memory_order_relaxed) << "\n";
+  for (unsigned int i = 0; i < n_mutation_types; i++) {
+    uint64_t attempted = mutations_attempted[i].load(std::memory_order_relaxed);
+    uint64_t applied = mutations_applied[i].load(std::memory_order_relaxed);
+    s << "  mutations " << mutation_names[i] << ": " << applied << " of "
+      << attempted << " applied ("
+      << (attempted ? 100.0 * applied / attempted : 0.0) << "%)\n";
+  }
+  s << "  peak RSS: " << peak_rss() / double(1 << 20) << " MiB\n";
+  out << s.str() << std::flush;
+}
+
+// Member which counts copies of whatever holds it, but not moves
+struct CopyCounter {
+  CopyCounter() = default;
+  CopyCounter(CopyCounter &&) = default;
+  CopyCounter &operator=(CopyCounter &&) = default;
+  CopyCounter(const CopyCounter &) {
+    counters.add(counters.specimens_copied, 1);
+  }
+  CopyCounter &operator=(const CopyCounter &) {
+    counters.add(counters.specimens_copied, 1);
+    return *this;
+  }
+};
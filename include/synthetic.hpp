@@ -0,0 +1,234 @@
+#pragma once
+
+#include "autograph.hpp"
+
+#include <random>
+#include <unordered_set>
+
+// Random bipartate graphs with a planted layout whose crossings are known,
+// for benchmarks and for measuring how close the optimiser gets.
+
+struct SyntheticSpec {
+  unsigned int n_t1 = 1000;
+  unsigned int n_t2 = 1000;
+
+  // Fraction of cells linked, at most every cell within the components
+  double density = 0.002;
+
+  // "uniform" or "powerlaw" degrees of the t1 nodes
+  std::string degrees = "uniform";
+  double exponent = 2.5;
+
+  // Independent groups of rows and columns, no edges run between them
+  unsigned int components = 1;
+
+  // Layout of the edges within each component in the planted order:
+  //   "none"      anywhere in the component
+  //   "block"     within square blocks along the component's diagonal
+  //   "diagonal"  within a narrow band around the diagonal
+  std::string structure = "diagonal";
+
+  // Number of blocks per component for the "block" structure
+  unsigned int blocks = 4;
+
+  // Fraction of edges placed anywhere in their component regardless
+  double noise = 0;
+
+  uint64_t seed = 1;
+};
+
+struct SyntheticGraph {
+
+  // Rows and columns shuffled, as an input to the optimiser
+  Topology topology;
+
+  // The planted layout: row and column ids from top to bottom
+  std::vector<unsigned int> t1_order;
+  std::vector<unsigned int> t2_order;
+
+  // Crossings of the planted layout with each tower in one column
+  unsigned long planted_crossings;
+};
+
+// Crossings of a layout with every t1 node in one column and every t2 node
+// in the next, rows and columns ranked by t1_rank and t2_rank. Counted as
+// inversions with a Fenwick tree, O(E log V).
+unsigned long count_crossings(const Topology &topology,
+                              const std::vector<unsigned int> &t1_rank,
+                              const std::vector<unsigned int> &t2_rank) {
+  std::vector<unsigned int> rows(topology.n_t1);
+  for (unsigned int id = 0; id < topology.n_t1; id++) {
+    rows[t1_rank[id]] = id;
+  }
+
+  std::vector<unsigned long> tree(topology.n_t2 + 1, 0);
+  unsigned long n_placed = 0;
+  unsigned long crossings = 0;
+  for (unsigned int id : rows) {
+    unsigned int begin = topology.offsets[id];
+    unsigned int end = topology.offsets[id + 1];
+
+    // Edges of earlier rows to lower columns cross, those sharing this row
+    // do not, so the whole row is counted before any of it is added
+    for (unsigned int e = begin; e < end; e++) {
+      unsigned long at_or_above = 0;
+      unsigned int col = t2_rank[topology.neighbours[e]];
+      for (unsigned int i = col + 1; i; i -= i & -i) {
+        at_or_above += tree[i];
+      }
+      crossings += n_placed - at_or_above;
+    }
+    for (unsigned int e = begin; e < end; e++) {
+      for (unsigned int i = t2_rank[topology.neighbours[e]] + 1;
+           i <= topology.n_t2; i += i & -i) {
+        tree[i]++;
+      }
+      n_placed++;
+    }
+  }
+  return crossings;
+}
+
+SyntheticGraph generate(const SyntheticSpec &spec) {
+  std::mt19937_64 rng(spec.seed);
+  std::uniform_real_distribution<double> unit(0, 1);
+  unsigned int components = std::max(1u, spec.components);
+
+  // Degree weight of every row in planted order
+  std::vector<double> row_weights(spec.n_t1, 1);
+  if (spec.degrees == "powerlaw") {
+    for (unsigned int r = 0; r < spec.n_t1; r++) {
+      row_weights[r] = std::pow(r + 1, -1 / std::max(1.01, spec.exponent - 1));
+    }
+    std::shuffle(row_weights.begin(), row_weights.end(), rng);
+  }
+  std::discrete_distribution<unsigned int> pick_row(row_weights.begin(),
+                                                    row_weights.end());
+
+  // Cells that can be linked, those within a component
+  uint64_t n_cells = 0;
+  for (uint64_t c = 0; c < components; c++) {
+    n_cells += ((c + 1) * spec.n_t1 / components - c * spec.n_t1 / components) *
+               ((c + 1) * spec.n_t2 / components - c * spec.n_t2 / components);
+  }
+  size_t n_edges = std::min<uint64_t>(
+      std::llround(spec.density * spec.n_t1 * spec.n_t2), n_cells);
+
+  // Pick distinct cells in planted coordinates, drawing again when a cell
+  // is already linked. After many draws in a row land on linked cells, they
+  // are made anywhere in the component, so a crowded structure still fills.
+  std::vector<Triplet> cells;
+  cells.reserve(n_edges);
+  std::unordered_set<uint64_t> linked;
+  linked.reserve(n_edges);
+  const unsigned int max_misses = 64;
+  unsigned int misses = 0;
+  while (cells.size() < n_edges) {
+    unsigned int row = pick_row(rng);
+
+    // Columns of this row's component
+    unsigned int component = uint64_t(row) * components / spec.n_t1;
+    unsigned int first = uint64_t(component) * spec.n_t2 / components;
+    unsigned int last = uint64_t(component + 1) * spec.n_t2 / components;
+    if (first == last) {
+      continue;
+    }
+    unsigned int first_row = uint64_t(component) * spec.n_t1 / components;
+    unsigned int last_row = uint64_t(component + 1) * spec.n_t1 / components;
+
+    // Where the row sits in its component, 0 at the top and 1 at the bottom
+    double at = double(row - first_row) / (last_row - first_row);
+    unsigned int width = last - first;
+    double col;
+    if (unit(rng) < spec.noise || spec.structure == "none" ||
+        misses >= max_misses) {
+      col = unit(rng) * width;
+    } else if (spec.structure == "block") {
+      unsigned int blocks = std::clamp(spec.blocks, 1u, width);
+      unsigned int block = at * blocks;
+      col = (block + unit(rng)) * width / blocks;
+    } else {
+
+      // Band about as wide as a row's expected degree
+      double band = std::max(1.0, spec.density * width);
+      col = at * width + (unit(rng) - 0.5) * band;
+    }
+    unsigned int offset = std::clamp<double>(col, 0, width - 1);
+    if (!linked.insert(uint64_t(row) * spec.n_t2 + first + offset).second) {
+      misses++;
+      continue;
+    }
+    misses = 0;
+    cells.push_back({row, first + offset, 1});
+  }
+
+  // Shuffle ids, so the optimiser has to find the planted order
+  SyntheticGraph graph;
+  graph.t1_order.resize(spec.n_t1);
+  graph.t2_order.resize(spec.n_t2);
+  std::iota(graph.t1_order.begin(), graph.t1_order.end(), 0);
+  std::iota(graph.t2_order.begin(), graph.t2_order.end(), 0);
+  std::shuffle(graph.t1_order.begin(), graph.t1_order.end(), rng);
+  std::shuffle(graph.t2_order.begin(), graph.t2_order.end(), rng);
+  for (Triplet &t : cells) {
+    t.row = graph.t1_order[t.row];
+    t.col = graph.t2_order[t.col];
+  }
+  graph.topology = from_triplets(spec.n_t1, spec.n_t2, cells);
+
+  std::vector<unsigned int> t1_rank(spec.n_t1);
+  std::vector<unsigned int> t2_rank(spec.n_t2);
+  for (unsigned int r = 0; r < spec.n_t1; r++) {
+    t1_rank[graph.t1_order[r]] = r;
+  }
+  for (unsigned int c = 0; c < spec.n_t2; c++) {
+    t2_rank[graph.t2_order[c]] = c;
+  }
+  graph.planted_crossings = count_crossings(graph.topology, t1_rank, t2_rank);
+  return graph;
+}
+
+// Write a graph as a dense CSV, an edge list (.edges, .el) or a Matrix Market
+// file (.mtx), streamed a row at a time
+void write_topology(const std::string &file_name, const Topology &topology) {
+  std::string extension = file_name.substr(file_name.find_last_of('.') + 1);
+  std::ofstream f(file_name, std::ios::binary);
+  TextBuffer out;
+  bool mtx = extension == "mtx";
+  bool edge_list = extension == "edges" || extension == "el";
+
+  if (mtx) {
+    out << "%%MatrixMarket matrix coordinate integer general\n";
+    out << topology.n_t1 << ' ' << topology.n_t2 << ' '
+        << topology.n_edges() << '\n';
+  } else if (edge_list) {
+    out << "# row col weight\n";
+    out << "# size " << topology.n_t1 << ' ' << topology.n_t2 << '\n';
+  }
+
+  std::vector<int> cells(topology.n_t2, 0);
+  for (unsigned int r = 0; r < topology.n_t1; r++) {
+    unsigned int begin = topology.offsets[r];
+    unsigned int end = topology.offsets[r + 1];
+    if (mtx || edge_list) {
+      for (unsigned int e = begin; e < end; e++) {
+        out << r + mtx << ' ' << topology.neighbours[e] + mtx << ' '
+            << topology.weights[e] << '\n';
+      }
+    } else {
+      for (unsigned int e = begin; e < end; e++) {
+        cells[topology.neighbours[e]] = topology.weights[e];
+      }
+      for (unsigned int c = 0; c < topology.n_t2; c++) {
+        out << (c ? "," : "") << cells[c];
+      }
+      out << '\n';
+      for (unsigned int e = begin; e < end; e++) {
+        cells[topology.neighbours[e]] = 0;
+      }
+    }
+    f.write(out.view().data(), out.view().size());
+    out.clear();
+  }
+  f.write(out.view().data(), out.view().size());
+}
@@ -0,0 +1,1055 @@
+#pragma once
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+
+// Read only memory mapping of a whole file
+struct MappedFile {
+  const char *data;
+  size_t size;
+
+  MappedFile(const std::string &file_name);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+};
+
+MappedFile::MappedFile(const std::string &file_name) {
+  data = nullptr;
+  size = 0;
+
+  int fd = open(file_name.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st)) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::runtime_error("Could not open " + file_name);
+  }
+  size = st.st_size;
+
+  // mmap refuses empty files, which are simply empty graphs
+  if (size) {
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Could not map " + file_name);
+    }
+    madvise(p, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(p);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    munmap(const_cast<char *>(data), size);
+  }
+}
+
+// Label id of nodes which have none
+#define no_label UINT_MAX
+
+// Node labels stored back to back in a single string, addressed by id
+struct Labels {
+  std::string chars;
+  std::vector<unsigned int> offsets{0};
+
+  unsigned int size() const { return offsets.size() - 1; }
+  std::string_view operator[](unsigned int id) const {
+    return std::string_view(chars).substr(offsets[id],
+                                          offsets[id + 1] - offsets[id]);
+  }
+  unsigned int add(std::string_view label) {
+    chars += label;
+    offsets.push_back(chars.size());
+    return size() - 1;
+  }
+};
+
+// Adjacency of a bipartate graph in compressed sparse row form. Rows are the
+// nodes of t1, columns the nodes of t2.
+struct Topology {
+  unsigned int n_t1 = 0;
+  unsigned int n_t2 = 0;
+
+  // Neighbours of row r are neighbours[offsets[r]] to neighbours[offsets[r+1]]
+  std::vector<unsigned int> offsets{0};
+  std::vector<unsigned int> neighbours;
+  std::vector<int> weights;
+
+  // Label id of every row and column, both empty for unlabelled matrices
+  Labels labels;
+  std::vector<unsigned int> t1_labels;
+  std::vector<unsigned int> t2_labels;
+
+  // hash_bytes of the file read, 0 when not read through load_topology
+  uint64_t source_hash = 0;
+
+  size_t n_edges() const { return neighbours.size(); }
+};
+
+// Skip spaces and tabs (and the \r of \r\n line endings) around a cell
+const char *skip_blanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+// Split the next cell off a line as a label, dropping blanks and quotes
+// around it
+std::string_view parse_label(const char *&p, const char *end) {
+  p = skip_blanks(p, end);
+  std::string_view label;
+  const char *close = nullptr;
+  if (p < end && *p == '"') {
+    close = static_cast<const char *>(std::memchr(p + 1, '"', end - p - 1));
+  }
+
+  // Quoted labels may contain commas
+  if (close) {
+    label = std::string_view(p + 1, close - p - 1);
+    p = skip_blanks(close + 1, end);
+  } else {
+    const char *comma = static_cast<const char *>(std::memchr(p, ',', end - p));
+    if (!comma) {
+      comma = end;
+    }
+    const char *last = comma;
+    while (last > p &&
+           (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) {
+      last--;
+    }
+    label = std::string_view(p, last - p);
+    p = comma;
+  }
+
+  // Step over the delimiter
+  if (p < end) {
+    p++;
+  }
+  return label;
+}
+
+// Is the first cell of the line [p, end) a number?
+bool starts_with_number(const char *p, const char *end) {
+  int value;
+  p = skip_blanks(p, end);
+  auto [next, ec] = std::from_chars(p, end, value);
+  next = skip_blanks(next, end);
+  return ec == std::errc() && (next == end || *next == ',');
+}
+
+// Parse one line of a dense CSV matrix, appending its non zero cells to the
+// adjacency. Returns the number of columns on the line.
+unsigned int parse_csv_row(const char *p, const char *end, Topology &topology,
+                           unsigned int n_line) {
+  unsigned int n_col = 0;
+  while (p < end) {
+
+    // Nearly every cell of a sparse matrix is a bare 0
+    if (end - p >= 2 && p[0] == '0' && p[1] == ',') {
+      p += 2;
+      n_col++;
+      continue;
+    }
+
+    int weight = 0;
+    p = skip_blanks(p, end);
+    auto [next, ec] = std::from_chars(p, end, weight);
+    if (ec != std::errc()) {
+      throw std::runtime_error("Bad value on line " + std::to_string(n_line) +
+                               ", column " + std::to_string(n_col + 1));
+    }
+    p = skip_blanks(next, end);
+    if (p < end && *p != ',') {
+      throw std::runtime_error("Bad value on line " + std::to_string(n_line) +
+                               ", column " + std::to_string(n_col + 1));
+    }
+
+    // If linked
+    if (weight) {
+      topology.neighbours.push_back(n_col);
+      topology.weights.push_back(weight);
+    }
+    n_col++;
+
+    // Step over the delimiter, a trailing one does not start another cell
+    if (p < end) {
+      p++;
+    }
+  }
+  return n_col;
+}
+
+// Parse every line in [p, end), appending the rows to the adjacency. n_line
+// is the line number of p, only used for error messages. When row_labels is
+// given the first cell of every line is a label and is appended to it.
+void parse_csv_rows(const char *p, const char *end, Topology &topology,
+                    unsigned int n_line,
+                    std::vector<std::string_view> *row_labels = nullptr) {
+  while (p < end) {
+    const char *eol =
+        static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (!eol) {
+      eol = end;
+    }
+
+    // Blank lines (including a trailing \r\n) are not rows
+    if (skip_blanks(p, eol) != eol) {
+      if (row_labels) {
+        row_labels->push_back(parse_label(p, eol));
+      }
+      unsigned int n_col = parse_csv_row(p, eol, topology, n_line);
+      if (topology.n_t1 && n_col != topology.n_t2) {
+        throw std::runtime_error(
+            "Line " + std::to_string(n_line) + " has " +
+            std::to_string(n_col) + " columns, not " +
+            std::to_string(topology.n_t2) + " as the line before");
+      }
+      topology.n_t2 = n_col;
+      topology.offsets.push_back(topology.neighbours.size());
+      topology.n_t1++;
+    }
+    p = eol + 1;
+    n_line++;
+  }
+}
+
+// Run task(0) to task(n - 1) on a thread each
+template <typename Task> void run_parallel(unsigned int n, Task task) {
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < n; i++) {
+    threads.emplace_back(task, i);
+  }
+  task(0);
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// Threads kept between batches, for work repeated too often to start a
+// thread each time. run(n, task) runs task(0) on the caller and task(1) to
+// task(n - 1) on the pool, which grows as needed, and returns when all are
+// done.
+struct WorkerPool {
+  std::vector<std::thread> threads;
+  std::mutex m;
+  std::condition_variable started;
+  std::condition_variable finished;
+  std::function<void(unsigned int)> task;
+  unsigned int n_tasks = 0;
+  unsigned int n_running = 0;
+  uint64_t batch = 0;
+  bool done = false;
+
+  WorkerPool() = default;
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  ~WorkerPool();
+  void run(unsigned int n, std::function<void(unsigned int)> f);
+  void work(unsigned int i, uint64_t seen);
+};
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m);
+    done = true;
+  }
+  started.notify_all();
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+void WorkerPool::run(unsigned int n, std::function<void(unsigned int)> f) {
+  if (n <= 1) {
+    if (n) {
+      f(0);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m);
+
+    // New threads start waiting for the batch about to be handed out
+    while (threads.size() + 1 < n) {
+      threads.emplace_back(&WorkerPool::work, this, threads.size() + 1, batch);
+    }
+    task = std::move(f);
+    n_tasks = n;
+    n_running = n - 1;
+    batch++;
+  }
+  started.notify_all();
+
+  // task is left alone until every worker is done with it
+  task(0);
+  std::unique_lock<std::mutex> lock(m);
+  finished.wait(lock, [this] { return !n_running; });
+}
+
+void WorkerPool::work(unsigned int i, uint64_t seen) {
+  AUTOGRAPH_TRACE_THREAD("worker " + std::to_string(i));
+  std::unique_lock<std::mutex> lock(m);
+  while (true) {
+    started.wait(lock, [&] { return done || batch != seen; });
+    if (done) {
+      return;
+    }
+    seen = batch;
+    if (i < n_tasks) {
+      lock.unlock();
+      task(i);
+      lock.lock();
+      if (!--n_running) {
+        finished.notify_one();
+      }
+    }
+  }
+}
+
+// Smallest piece of a CSV worth handing to a thread of its own
+#define csv_chunk_size (4 << 20)
+
+// Read a dense CSV adjacency matrix straight into CSR form. Large files are
+// split into newline aligned chunks which are parsed concurrently, using up
+// to n_threads threads (0: one per core).
+//
+// A first line which does not start with a number holds column labels, and
+// rows which do not start with a number have a label in their first cell.
+Topology read_csv(const std::string &csv_name, unsigned int n_threads = 0) {
+  AUTOGRAPH_TRACE_SCOPE("read_csv");
+  MappedFile f(csv_name);
+  const char *end = f.data + f.size;
+  const char *body = f.data;
+  unsigned int body_line = 1;
+
+  // Header row of column labels
+  std::vector<std::string_view> column_labels;
+  const char *eol = static_cast<const char *>(std::memchr(body, '\n', f.size));
+  if (!eol) {
+    eol = end;
+  }
+  if (body < end && !starts_with_number(body, eol)) {
+    for (const char *p = body; p < eol;) {
+      column_labels.push_back(parse_label(p, eol));
+    }
+    body = std::min(eol + 1, end);
+    body_line++;
+  }
+
+  // Row labels are looked for on the first row of the matrix itself
+  eol = static_cast<const char *>(std::memchr(body, '\n', end - body));
+  bool labelled = body < end && !starts_with_number(body, eol ? eol : end);
+
+  // The corner cell above the row labels labels nothing
+  if (labelled && !column_labels.empty()) {
+    column_labels.erase(column_labels.begin());
+  }
+
+  if (!n_threads) {
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  unsigned int n_chunks =
+      std::clamp<size_t>(f.size / csv_chunk_size, 1, n_threads);
+
+  // Chunk boundaries, each moved forward to just after a newline
+  std::vector<const char *> bounds{body};
+  for (unsigned int i = 1; i < n_chunks; i++) {
+    const char *p = std::max(body + (end - body) / n_chunks * i, bounds.back());
+    eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    bounds.push_back(eol ? eol + 1 : end);
+  }
+  bounds.push_back(end);
+
+  // Each chunk is parsed into its own buffers, row ids counted from 0
+  std::vector<Topology> chunks(n_chunks);
+  std::vector<std::vector<std::string_view>> row_labels(n_chunks);
+  std::vector<char> failed(n_chunks, false);
+  run_parallel(n_chunks, [&](unsigned int i) {
+    AUTOGRAPH_TRACE_SCOPE("parse_csv_rows");
+    try {
+
+      // Line numbers only matter for errors, so count them lazily there
+      parse_csv_rows(bounds[i], bounds[i + 1], chunks[i], 1,
+                     labelled ? &row_labels[i] : nullptr);
+    } catch (const std::runtime_error &) {
+      failed[i] = true;
+    }
+  });
+
+  // Parse a bad chunk again knowing its first line, to throw a useful error
+  for (unsigned int i = 0; i < n_chunks; i++) {
+    if (failed[i]) {
+      Topology rows;
+      parse_csv_rows(bounds[i], bounds[i + 1], rows,
+                     body_line + std::count(body, bounds[i], '\n'),
+                     labelled ? &row_labels[i] : nullptr);
+    }
+  }
+
+  // Every chunk has rows of one length, which must be the same for all
+  unsigned int n_cols = 0;
+  for (unsigned int i = 0; i < n_chunks; i++) {
+    if (chunks[i].n_t1 && n_cols && chunks[i].n_t2 != n_cols) {
+      throw std::runtime_error(
+          "Line " +
+          std::to_string(body_line + std::count(body, bounds[i], '\n')) +
+          " has " + std::to_string(chunks[i].n_t2) + " columns, not " +
+          std::to_string(n_cols) + " as the line before");
+    }
+    n_cols = chunks[i].n_t1 ? chunks[i].n_t2 : n_cols;
+  }
+
+  // Prefix sums of rows and edges place every chunk in the merged adjacency
+  Topology topology;
+  std::vector<unsigned int> first_row{0};
+  std::vector<size_t> first_edge{0};
+  for (auto &c : chunks) {
+    first_row.push_back(first_row.back() + c.n_t1);
+    first_edge.push_back(first_edge.back() + c.n_edges());
+    topology.n_t2 = std::max(topology.n_t2, c.n_t2);
+  }
+  topology.n_t1 = first_row.back();
+  topology.offsets.resize(topology.n_t1 + 1);
+  topology.neighbours.resize(first_edge.back());
+  topology.weights.resize(first_edge.back());
+
+  run_parallel(n_chunks, [&](unsigned int i) {
+    AUTOGRAPH_TRACE_SCOPE("merge_csv_rows");
+    for (unsigned int r = 1; r <= chunks[i].n_t1; r++) {
+      topology.offsets[first_row[i] + r] = first_edge[i] + chunks[i].offsets[r];
+    }
+    std::copy(chunks[i].neighbours.begin(), chunks[i].neighbours.end(),
+              topology.neighbours.begin() + first_edge[i]);
+    std::copy(chunks[i].weights.begin(), chunks[i].weights.end(),
+              topology.weights.begin() + first_edge[i]);
+
+    // Release the chunk as soon as it has been merged
+    chunks[i] = Topology();
+  });
+
+  if (labelled || !column_labels.empty()) {
+    topology.n_t2 = std::max<unsigned int>(topology.n_t2, column_labels.size());
+
+    // Interned while the text is still mapped, so the keys need no copies
+    std::unordered_map<std::string_view, unsigned int> ids;
+    auto intern = [&](std::string_view label) {
+      auto [it, inserted] = ids.try_emplace(label, topology.labels.size());
+      if (inserted) {
+        topology.labels.add(label);
+      }
+      return it->second;
+    };
+
+    topology.t1_labels.assign(topology.n_t1, no_label);
+    unsigned int n_row = 0;
+    for (auto &chunk : row_labels) {
+      for (std::string_view label : chunk) {
+        topology.t1_labels[n_row++] = intern(label);
+      }
+    }
+    topology.t2_labels.assign(topology.n_t2, no_label);
+    for (unsigned int n_col = 0; n_col < column_labels.size(); n_col++) {
+      topology.t2_labels[n_col] = intern(column_labels[n_col]);
+    }
+  }
+  return topology;
+}
+
+// One non zero cell of a sparse matrix
+struct Triplet {
+  unsigned int row;
+  unsigned int col;
+  int weight;
+};
+
+// Build CSR adjacency from cells in any order by counting sort, O(E). Cells
+// given more than once have their weights summed.
+Topology from_triplets(unsigned int n_t1, unsigned int n_t2,
+                       const std::vector<Triplet> &cells) {
+  Topology topology;
+  topology.n_t1 = n_t1;
+  topology.n_t2 = n_t2;
+
+  // Count, then prefix sum, the cells of every row
+  topology.offsets.assign(size_t(n_t1) + 1, 0);
+  for (const Triplet &t : cells) {
+    if (t.row >= n_t1 || t.col >= n_t2) {
+      throw std::runtime_error("Cell outside the matrix's size");
+    }
+    topology.offsets[t.row + 1]++;
+  }
+  for (unsigned int r = 0; r < n_t1; r++) {
+    topology.offsets[r + 1] += topology.offsets[r];
+  }
+
+  std::vector<std::pair<unsigned int, int>> scattered(cells.size());
+  std::vector<unsigned int> next(topology.offsets.begin(),
+                                 topology.offsets.end() - 1);
+  for (const Triplet &t : cells) {
+    scattered[next[t.row]++] = {t.col, t.weight};
+  }
+
+  // Order each row by column like a dense matrix, merging duplicates
+  topology.neighbours.reserve(cells.size());
+  topology.weights.reserve(cells.size());
+  unsigned int begin = 0;
+  for (unsigned int r = 0; r < n_t1; r++) {
+    unsigned int end = topology.offsets[r + 1];
+    std::sort(scattered.begin() + begin, scattered.begin() + end);
+    for (unsigned int e = begin; e < end; e++) {
+      if (topology.neighbours.size() > topology.offsets[r] &&
+          scattered[e].first == topology.neighbours.back()) {
+        topology.weights.back() += scattered[e].second;
+      } else {
+        topology.neighbours.push_back(scattered[e].first);
+        topology.weights.push_back(scattered[e].second);
+      }
+    }
+    begin = end;
+    topology.offsets[r + 1] = topology.neighbours.size();
+  }
+  return topology;
+}
+
+// Split the next comma or whitespace separated token off a line
+std::string_view next_token(const char *&p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == ',')) {
+    p++;
+  }
+  const char *begin = p;
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != ',') {
+    p++;
+  }
+  return std::string_view(begin, p - begin);
+}
+
+// Parse a whole token as a number
+template <typename T> bool parse_number(std::string_view token, T &value) {
+  auto [next, ec] =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  return ec == std::errc() && next == token.data() + token.size();
+}
+
+// Call line(p, eol, n_line) for every line of [p, end) that is not blank or
+// a # or % comment
+template <typename Line>
+void for_each_line(const char *p, const char *end, Line line) {
+  unsigned int n_line = 0;
+  while (p < end) {
+    const char *eol =
+        static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (!eol) {
+      eol = end;
+    }
+    n_line++;
+    const char *first = skip_blanks(p, eol);
+    if (first != eol && *first != '#' && *first != '%') {
+      line(p, eol, n_line);
+    }
+    p = eol + 1;
+  }
+}
+
+// Read a sparse edge list, one "row col [weight]" per line separated by
+// commas or whitespace. Rows and columns are either ids counted from 0, or
+// labels which are then interned, in which case ids follow first appearance.
+// A missing weight is 1. A "# size rows cols" comment among those at the top
+// gives the size of numbered graphs, which otherwise ends at their last edge.
+Topology read_edge_list(const std::string &file_name) {
+  MappedFile f(file_name);
+  const char *end = f.data + f.size;
+  std::vector<Triplet> cells;
+  unsigned int n_t1 = 0;
+  unsigned int n_t2 = 0;
+  bool sized = false;
+  for (const char *p = f.data; p < end && !sized;) {
+    const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (!eol) {
+      eol = end;
+    }
+    const char *first = skip_blanks(p, eol);
+    if (first == eol || (*first != '#' && *first != '%')) {
+      break;
+    }
+    first++;
+    if (next_token(first, eol) == "size") {
+      if (!parse_number(next_token(first, eol), n_t1) ||
+          !parse_number(next_token(first, eol), n_t2)) {
+        throw std::runtime_error("Bad size comment");
+      }
+      sized = true;
+    }
+    p = eol + 1;
+  }
+
+  Labels labels;
+  std::vector<unsigned int> t1_labels;
+  std::vector<unsigned int> t2_labels;
+  std::unordered_map<std::string_view, unsigned int> label_ids;
+  std::unordered_map<std::string_view, unsigned int> row_ids;
+  std::unordered_map<std::string_view, unsigned int> col_ids;
+
+  // Whether ids are labels is settled by the first edge
+  int named = -1;
+
+  // Id of a labelled node, adding the node on first sight
+  auto node_id = [&](std::string_view label,
+                     std::unordered_map<std::string_view, unsigned int> &ids,
+                     std::vector<unsigned int> &tower) {
+    auto [it, inserted] = ids.try_emplace(label, tower.size());
+    if (inserted) {
+      auto [l, added] = label_ids.try_emplace(label, labels.size());
+      if (added) {
+        labels.add(label);
+      }
+      tower.push_back(l->second);
+    }
+    return it->second;
+  };
+
+  for_each_line(f.data, end, [&](const char *p, const char *eol,
+                                 unsigned int n_line) {
+    std::string_view from = next_token(p, eol);
+    std::string_view to = next_token(p, eol);
+    std::string_view weight_token = next_token(p, eol);
+    Triplet t{0, 0, 1};
+    if (named < 0) {
+      named = !parse_number(from, t.row);
+      if (named && sized) {
+        throw std::runtime_error("A size comment needs numbered nodes");
+      }
+    }
+
+    bool ok = !to.empty() &&
+              (weight_token.empty() || parse_number(weight_token, t.weight));
+    if (named) {
+      t.row = node_id(from, row_ids, t1_labels);
+      t.col = node_id(to, col_ids, t2_labels);
+    } else {
+      ok = ok && parse_number(from, t.row) && parse_number(to, t.col);
+    }
+    if (!ok || (sized && (t.row >= n_t1 || t.col >= n_t2))) {
+      throw std::runtime_error("Bad edge on line " + std::to_string(n_line));
+    }
+
+    n_t1 = std::max(n_t1, t.row + 1);
+    n_t2 = std::max(n_t2, t.col + 1);
+    if (t.weight) {
+      cells.push_back(t);
+    }
+  });
+
+  Topology topology = from_triplets(n_t1, n_t2, cells);
+  if (named > 0) {
+    topology.labels = labels;
+    topology.t1_labels = t1_labels;
+    topology.t2_labels = t2_labels;
+  }
+  return topology;
+}
+
+// Read a Matrix Market coordinate matrix. Real weights are rounded, keeping
+// at least a weight of 1 so that no link is lost.
+Topology read_mtx(const std::string &file_name) {
+  MappedFile f(file_name);
+  const char *end = f.data + f.size;
+
+  // %%MatrixMarket matrix coordinate <field> <symmetry>
+  const char *eol =
+      static_cast<const char *>(std::memchr(f.data, '\n', f.size));
+  const char *p = f.data;
+  std::vector<std::string_view> banner;
+  std::string_view token;
+  while (!(token = next_token(p, eol ? eol : end)).empty()) {
+    banner.push_back(token);
+  }
+  if (banner.size() < 5 || banner[0] != "%%MatrixMarket" ||
+      banner[1] != "matrix") {
+    throw std::runtime_error("Missing %%MatrixMarket matrix header");
+  }
+  if (banner[2] != "coordinate") {
+    throw std::runtime_error(
+        "Only coordinate Matrix Market files are supported");
+  }
+  bool pattern = banner[3] == "pattern";
+  bool symmetric = banner[4] == "symmetric" || banner[4] == "hermitian";
+  bool skew = banner[4] == "skew-symmetric";
+
+  // Shortest an entry can be, as "1 1\n", bounds how many the file can hold
+  size_t max_entries = f.size / 4 + 1;
+
+  unsigned int n_t1 = 0;
+  unsigned int n_t2 = 0;
+  size_t n_entries = 0;
+  bool sized = false;
+  std::vector<Triplet> cells;
+
+  for_each_line(f.data, end, [&](const char *line, const char *line_end,
+                                 unsigned int n_line) {
+    std::string_view a = next_token(line, line_end);
+    std::string_view b = next_token(line, line_end);
+    std::string_view c = next_token(line, line_end);
+
+    // First line after the comments is "rows cols entries"
+    if (!sized) {
+      if (!parse_number(a, n_t1) || !parse_number(b, n_t2) ||
+          !parse_number(c, n_entries)) {
+        throw std::runtime_error("Bad size on line " + std::to_string(n_line));
+      }
+      if ((symmetric || skew) && n_t1 != n_t2) {
+        throw std::runtime_error("A symmetric matrix must be square");
+      }
+      n_entries = std::min(n_entries, max_entries);
+      cells.reserve(symmetric || skew ? 2 * n_entries : n_entries);
+      sized = true;
+      return;
+    }
+
+    // Entries count from 1
+    Triplet t{0, 0, 1};
+    double value = 1;
+    if (!parse_number(a, t.row) || !parse_number(b, t.col) || !t.row ||
+        !t.col || t.row > n_t1 || t.col > n_t2 ||
+        (!pattern && !parse_number(c, value))) {
+      throw std::runtime_error("Bad entry on line " + std::to_string(n_line));
+    }
+    t.row--;
+    t.col--;
+    if (!value) {
+      return;
+    }
+    t.weight = std::lround(value);
+    if (!t.weight) {
+      t.weight = value < 0 ? -1 : 1;
+    }
+    cells.push_back(t);
+
+    // Only one triangle of a symmetric matrix is stored
+    if ((symmetric || skew) && t.row != t.col) {
+      cells.push_back({t.col, t.row, skew ? -t.weight : t.weight});
+    }
+  });
+
+  return from_triplets(n_t1, n_t2, cells);
+}
+
+// Whether the text of a file not marked as any format is an edge list. Its
+// first line then holds two or three fields separated by whitespace, which
+// no dense CSV row of more than one cell is, or two or three numbers
+// separated by commas in a file with a different number of lines, which
+// as a dense matrix would be far from square.
+bool looks_like_edge_list(const char *data, size_t size) {
+  const char *end = data + size;
+  const char *p = data;
+  const char *eol = end;
+  while (p < end) {
+    eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (!eol) {
+      eol = end;
+    }
+    if (skip_blanks(p, eol) != eol) {
+      break;
+    }
+    p = eol + 1;
+  }
+  if (p >= end) {
+    return false;
+  }
+
+  bool commas = std::find(p, eol, ',') != eol;
+  bool numbers = true;
+  unsigned int n_fields = 0;
+  std::string_view token;
+  for (const char *q = p; !(token = next_token(q, eol)).empty();) {
+    int value;
+    numbers = numbers && parse_number(token, value);
+    n_fields++;
+  }
+  if (n_fields < 2 || n_fields > 3) {
+    return false;
+  }
+  if (!commas) {
+    return true;
+  }
+  size_t n_lines = std::count(p, end, '\n') + (end[-1] != '\n');
+  return numbers && n_lines != n_fields;
+}
+
+// Read an adjacency matrix in whichever format it is in: Matrix Market
+// (.mtx or the %%MatrixMarket banner), an edge list (.edges, .el, a file
+// starting with a # or % comment, or one whose first line reads as an edge)
+// or otherwise a dense CSV.
+Topology read_topology(const std::string &file_name,
+                       unsigned int n_threads = 0) {
+  std::string extension = file_name.substr(file_name.find_last_of('.') + 1);
+  std::string start;
+  bool edges;
+  {
+    MappedFile f(file_name);
+    start = std::string(f.data, std::min<size_t>(f.size, 14));
+    edges = looks_like_edge_list(f.data, f.size);
+  }
+
+  if (extension == "mtx" || start == "%%MatrixMarket") {
+    return read_mtx(file_name);
+  }
+  if (extension == "edges" || extension == "el" || edges ||
+      (!start.empty() && (start[0] == '#' || start[0] == '%'))) {
+    return read_edge_list(file_name);
+  }
+  return read_csv(file_name, n_threads);
+}
+
+// 64 bit hash of a block of memory, four independent multiply-xor lanes so
+// that hashing runs at about memory bandwidth
+uint64_t hash_bytes(const char *data, size_t size) {
+  const uint64_t prime = 0x9e3779b97f4a7c15ull;
+  uint64_t lanes[4] = {size, prime, ~size, ~prime};
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    for (unsigned int l = 0; l < 4; l++) {
+      uint64_t word;
+      std::memcpy(&word, data + i + 8 * l, 8);
+      lanes[l] = (lanes[l] ^ word) * prime;
+      lanes[l] ^= lanes[l] >> 29;
+    }
+  }
+  uint64_t h = lanes[0] ^ (lanes[1] << 1) ^ (lanes[2] << 2) ^ (lanes[3] << 3);
+  for (; i < size; i++) {
+    h = (h ^ static_cast<unsigned char>(data[i])) * prime;
+  }
+  h ^= h >> 32;
+  return h * prime;
+}
+
+// Graph cache layout, all integers native endian:
+//   GraphCacheHeader, then offsets, neighbours, weights, label offsets,
+//   t1 labels, t2 labels (each empty when unlabelled) and label characters
+#define graph_cache_magic "AGGC"
+#define graph_cache_version 2
+
+// What identifies the file a graph was read from. The size and modification
+// time show it unchanged without reading it, the hash of its contents when
+// it was only touched.
+struct GraphSource {
+  uint64_t hash;
+  uint64_t size;
+  int64_t time;
+};
+
+struct GraphCacheHeader {
+  char magic[4];
+  uint32_t version;
+  GraphSource source;
+
+  uint32_t n_t1;
+  uint32_t n_t2;
+  uint64_t n_edges;
+  uint32_t n_labels;
+  uint32_t labelled;
+  uint64_t label_bytes;
+};
+
+template <typename T>
+void write_array(std::ofstream &f, const std::vector<T> &array) {
+  f.write(reinterpret_cast<const char *>(array.data()),
+          array.size() * sizeof(T));
+}
+
+// Copy n elements out of the mapped cache, advancing p past them
+template <typename T>
+void read_array(const char *&p, std::vector<T> &array, size_t n) {
+  array.resize(n);
+  std::memcpy(array.data(), p, n * sizeof(T));
+  p += n * sizeof(T);
+}
+
+// Whether offsets run from 0 to total without going back
+bool valid_offsets(const std::vector<unsigned int> &offsets, uint64_t total) {
+  return !offsets.empty() && offsets.front() == 0 &&
+         offsets.back() == total &&
+         std::is_sorted(offsets.begin(), offsets.end());
+}
+
+void write_graph_cache(const std::string &cache_name, const Topology &topology,
+                       const GraphSource &source) {
+  GraphCacheHeader header;
+  std::memcpy(header.magic, graph_cache_magic, 4);
+  header.version = graph_cache_version;
+  header.source = source;
+  header.n_t1 = topology.n_t1;
+  header.n_t2 = topology.n_t2;
+  header.n_edges = topology.n_edges();
+  header.n_labels = topology.labels.size();
+  header.labelled = !topology.t1_labels.empty() || !topology.t2_labels.empty();
+  header.label_bytes = topology.labels.chars.size();
+
+  // Written aside and renamed, so a reader never sees half a cache
+  std::string tmp_name = cache_name + ".tmp";
+  std::ofstream f(tmp_name, std::ios::binary);
+  f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  write_array(f, topology.offsets);
+  write_array(f, topology.neighbours);
+  write_array(f, topology.weights);
+  if (header.labelled) {
+    write_array(f, topology.labels.offsets);
+    write_array(f, topology.t1_labels);
+    write_array(f, topology.t2_labels);
+    f.write(topology.labels.chars.data(), header.label_bytes);
+  }
+  f.close();
+
+  if (!f || std::rename(tmp_name.c_str(), cache_name.c_str())) {
+    std::remove(tmp_name.c_str());
+    std::cerr << "Could not write graph cache " << cache_name << std::endl;
+  }
+}
+
+// Read a graph cache, returning false when it is missing, damaged or was
+// made from a different file. The source is matched by its size and either
+// its contents' hash, if hashed, or else its modification time. The hash
+// stored is then the source's.
+bool read_graph_cache(const std::string &cache_name, Topology &topology,
+                      const GraphSource &source, bool hashed) {
+  if (access(cache_name.c_str(), R_OK)) {
+    return false;
+  }
+  MappedFile f(cache_name);
+  GraphCacheHeader header;
+  if (f.size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, f.data, sizeof(header));
+  if (std::memcmp(header.magic, graph_cache_magic, 4) ||
+      header.version != graph_cache_version ||
+      header.source.size != source.size ||
+      (hashed ? header.source.hash != source.hash
+              : header.source.time != source.time)) {
+    return false;
+  }
+
+  // Counts are bounded by the file before being multiplied, so the size
+  // they add up to cannot overflow
+  if (header.n_edges > f.size / 8 || header.n_labels > f.size / 4 ||
+      header.label_bytes > f.size) {
+    return false;
+  }
+  uint64_t size = sizeof(header) +
+                  4 * (uint64_t(header.n_t1) + 1 + 2 * header.n_edges);
+  if (header.labelled) {
+    size += 4 * (uint64_t(header.n_labels) + 1 + header.n_t1 + header.n_t2) +
+            header.label_bytes;
+  }
+  if (f.size != size) {
+    return false;
+  }
+
+  const char *p = f.data + sizeof(header);
+  topology.n_t1 = header.n_t1;
+  topology.n_t2 = header.n_t2;
+  read_array(p, topology.offsets, header.n_t1 + 1);
+  read_array(p, topology.neighbours, header.n_edges);
+  read_array(p, topology.weights, header.n_edges);
+  if (header.labelled) {
+    read_array(p, topology.labels.offsets, header.n_labels + 1);
+    read_array(p, topology.t1_labels, header.n_t1);
+    read_array(p, topology.t2_labels, header.n_t2);
+    topology.labels.chars.assign(p, header.label_bytes);
+  }
+
+  // Sizes alone do not make a cache whole, every index in it is checked
+  auto is_label = [&](unsigned int label) {
+    return label < header.n_labels || label == no_label;
+  };
+  bool valid =
+      valid_offsets(topology.offsets, header.n_edges) &&
+      std::all_of(topology.neighbours.begin(), topology.neighbours.end(),
+                  [&](unsigned int n) { return n < header.n_t2; });
+  if (header.labelled) {
+    valid = valid &&
+            valid_offsets(topology.labels.offsets, header.label_bytes) &&
+            std::all_of(topology.t1_labels.begin(), topology.t1_labels.end(),
+                        is_label) &&
+            std::all_of(topology.t2_labels.begin(), topology.t2_labels.end(),
+                        is_label);
+  }
+  if (!valid) {
+    topology = Topology();
+    return false;
+  }
+  topology.source_hash = header.source.hash;
+  return true;
+}
+
+// Read an adjacency matrix through its graph cache (file_name + ".agc"),
+// which is written on the first read and used as long as the file's
+// contents are unchanged. A file with the size and modification time the
+// cache was made from is not read at all.
+Topology load_topology(const std::string &file_name, bool use_cache = true,
+                       unsigned int n_threads = 0) {
+  AUTOGRAPH_TRACE_SCOPE("load_topology");
+  GraphSource source;
+  {
+    MappedFile f(file_name);
+    source.size = f.size;
+  }
+  source.time =
+      std::filesystem::last_write_time(file_name).time_since_epoch().count();
+
+  Topology topology;
+  std::string cache_name = file_name + ".agc";
+  if (use_cache && read_graph_cache(cache_name, topology, source, false)) {
+    std::cout << "Read cached graph " << cache_name << std::endl;
+    return topology;
+  }
+
+  // Hashed even without the cache, checkpoints are matched to it
+  {
+    MappedFile f(file_name);
+    source.hash = hash_bytes(f.data, f.size);
+  }
+
+  // Only touched since, the cache is rewritten to match the new time
+  if (use_cache && read_graph_cache(cache_name, topology, source, true)) {
+    std::cout << "Read cached graph " << cache_name << std::endl;
+    write_graph_cache(cache_name, topology, source);
+    return topology;
+  }
+
+  topology = read_topology(file_name, n_threads);
+  topology.source_hash = source.hash;
+  if (use_cache) {
+    std::cout << "Writing " << cache_name << std::endl;
+    write_graph_cache(cache_name, topology, source);
+  }
+  return topology;
+}
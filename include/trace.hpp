@@ -0,0 +1,121 @@
+#pragma once
+
+// Scoped timers for the hot paths, written at exit to autograph_trace.json as
+// Chrome trace events, which open in Perfetto or chrome://tracing. Only built
+// when AUTOGRAPH_TRACE is defined (cmake -DAUTOGRAPH_TRACE=ON), otherwise
+// the macros expand to nothing.
+//
+//   AUTOGRAPH_TRACE_SCOPE("name")   time the rest of the enclosing block
+//   AUTOGRAPH_TRACE_THREAD("name")  name the calling thread in the trace
+
+#ifdef AUTOGRAPH_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define trace_file_name "autograph_trace.json"
+
+struct TraceEvent {
+  const char *name;
+  int64_t start_ns;
+  int64_t duration_ns;
+};
+
+// Events of one thread, only ever appended to by that thread
+struct TraceThread {
+  unsigned int tid;
+  std::string name;
+  std::vector<TraceEvent> events;
+};
+
+struct Tracer {
+  std::mutex mutex;
+  std::chrono::steady_clock::time_point epoch;
+
+  // Kept after their threads end, so their events can still be written
+  std::vector<std::shared_ptr<TraceThread>> threads;
+
+  Tracer() : epoch(std::chrono::steady_clock::now()) {}
+  ~Tracer() { write(trace_file_name); }
+  TraceThread &thread();
+  void write(std::string file_name);
+};
+
+Tracer &tracer() {
+  static Tracer t;
+  return t;
+}
+
+// The calling thread's events, registered on first use
+TraceThread &Tracer::thread() {
+  thread_local std::shared_ptr<TraceThread> local;
+  if (!local) {
+    std::lock_guard<std::mutex> lock(mutex);
+    local = std::make_shared<TraceThread>();
+    local->tid = threads.size();
+    local->name = local->tid ? "thread " + std::to_string(local->tid) : "main";
+    threads.push_back(local);
+  }
+  return *local;
+}
+
+// Timestamps in microseconds, as the format expects
+void Tracer::write(std::string file_name) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::ofstream f(file_name);
+  f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (auto &t : threads) {
+    f << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\","
+      << "\"pid\":1,\"tid\":" << t->tid << ",\"args\":{\"name\":\""
+      << t->name << "\"}}";
+    first = false;
+    for (TraceEvent &e : t->events) {
+      f << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+        << t->tid << ",\"ts\":" << e.start_ns / 1000 << '.'
+        << e.start_ns / 100 % 10 << ",\"dur\":" << e.duration_ns / 1000 << '.'
+        << e.duration_ns / 100 % 10 << '}';
+    }
+  }
+  f << "\n]}\n";
+}
+
+// Records its own lifetime as one event
+struct TraceScope {
+  const char *name;
+  std::chrono::steady_clock::time_point start;
+
+  // The tracer starts its clock first, so no event starts before it
+  TraceScope(const char *n) : name(n) {
+    tracer();
+    start = std::chrono::steady_clock::now();
+  }
+  ~TraceScope() {
+    Tracer &t = tracer();
+    auto end = std::chrono::steady_clock::now();
+    t.thread().events.push_back(
+        {name,
+         std::chrono::duration_cast<std::chrono::nanoseconds>(start - t.epoch)
+             .count(),
+         std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+             .count()});
+  }
+};
+
+#define trace_concat_(a, b) a##b
+#define trace_concat(a, b) trace_concat_(a, b)
+#define AUTOGRAPH_TRACE_SCOPE(name)                                            \
+  TraceScope trace_concat(trace_scope_, __LINE__)(name)
+#define AUTOGRAPH_TRACE_THREAD(thread_name) tracer().thread().name = thread_name
+
+#else
+
+#define AUTOGRAPH_TRACE_SCOPE(name)
+#define AUTOGRAPH_TRACE_THREAD(thread_name)
+
+#endif
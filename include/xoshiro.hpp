@@ -0,0 +1,197 @@
+#pragma once
+
+// A faster random engine and distributions for the effolkronium wrappers in
+// random.hpp: xoshiro256++ (Blackman and Vigna), drawn in batches, bounded
+// integers by Lemire's multiply-shift method, and coin flips by comparing a
+// single draw against a threshold.
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// Numbers drawn at a time into the engine's buffer
+#define xoshiro_batch_size 16
+
+__extension__ typedef unsigned __int128 uint128;
+
+class Xoshiro256pp {
+public:
+  using result_type = uint64_t;
+
+  Xoshiro256pp() { seed(); }
+  explicit Xoshiro256pp(result_type value) { seed(value); }
+  template <typename Sseq,
+            typename = std::enable_if_t<!std::is_integral_v<Sseq>>>
+  explicit Xoshiro256pp(Sseq &seq) {
+    seed(seq);
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  // The state from SplitMix64, as its authors suggest
+  void seed(result_type value = 0x853c49e6748fea9bull) {
+    for (uint64_t &s : state) {
+      value += 0x9e3779b97f4a7c15ull;
+      uint64_t z = value;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      s = z ^ (z >> 31);
+    }
+    next = xoshiro_batch_size;
+  }
+
+  template <typename Sseq,
+            typename = std::enable_if_t<!std::is_integral_v<Sseq>>>
+  void seed(Sseq &seq) {
+    std::array<uint32_t, 8> words;
+    seq.generate(words.begin(), words.end());
+    for (unsigned int i = 0; i < 4; i++) {
+      state[i] = uint64_t(words[2 * i]) << 32 | words[2 * i + 1];
+    }
+
+    // An all zero state would only ever give zeros
+    if (!(state[0] | state[1] | state[2] | state[3])) {
+      seed();
+    }
+    next = xoshiro_batch_size;
+  }
+
+  result_type operator()() {
+    if (next == xoshiro_batch_size) {
+      refill();
+    }
+    return batch[next++];
+  }
+
+  void discard(unsigned long long n) {
+    for (; n; n--) {
+      (*this)();
+    }
+  }
+
+  friend bool operator==(const Xoshiro256pp &a, const Xoshiro256pp &b) {
+    return a.saved_state() == b.saved_state() && a.next == b.next;
+  }
+
+  // Written as the state the current batch was drawn from and how much of
+  // it is used, so a restored engine continues with the same numbers
+  template <typename CharT, typename Traits>
+  friend std::basic_ostream<CharT, Traits> &
+  operator<<(std::basic_ostream<CharT, Traits> &out, const Xoshiro256pp &e) {
+    out << "xoshiro256++";
+    for (uint64_t s : e.saved_state()) {
+      out << ' ' << s;
+    }
+    return out << ' ' << e.next;
+  }
+
+  // Fails the stream on state written by any other engine
+  template <typename CharT, typename Traits>
+  friend std::basic_istream<CharT, Traits> &
+  operator>>(std::basic_istream<CharT, Traits> &in, Xoshiro256pp &e) {
+    std::basic_string<CharT, Traits> name;
+    std::array<uint64_t, 4> s;
+    unsigned int next;
+    in >> name >> s[0] >> s[1] >> s[2] >> s[3] >> next;
+    if (name != "xoshiro256++" || next > xoshiro_batch_size) {
+      in.setstate(std::ios::failbit);
+    }
+    if (in) {
+      e.state = s;
+      if (next < xoshiro_batch_size) {
+        e.refill();
+      }
+      e.next = next;
+    }
+    return in;
+  }
+
+private:
+  std::array<uint64_t, 4> state;
+  std::array<uint64_t, 4> batch_state;
+  std::array<uint64_t, xoshiro_batch_size> batch;
+  unsigned int next;
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  void refill() {
+    batch_state = state;
+    uint64_t s0 = state[0];
+    uint64_t s1 = state[1];
+    uint64_t s2 = state[2];
+    uint64_t s3 = state[3];
+    for (uint64_t &out : batch) {
+      out = rotl(s0 + s3, 23) + s0;
+      uint64_t t = s1 << 17;
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= t;
+      s3 = rotl(s3, 45);
+    }
+    state = {s0, s1, s2, s3};
+    next = 0;
+  }
+
+  const std::array<uint64_t, 4> &saved_state() const {
+    return next == xoshiro_batch_size ? state : batch_state;
+  }
+};
+
+// Integers in [a, b] from one multiplication in most cases, rejecting only
+// the few draws which would bias the result (Lemire, 2019)
+template <typename T> class LemireIntDistribution {
+public:
+  using result_type = T;
+  using Unsigned = std::make_unsigned_t<T>;
+
+  LemireIntDistribution(T a, T b) : a(a), b(b) {}
+
+  template <typename Engine> T operator()(Engine &engine) {
+    static_assert(Engine::min() == 0 &&
+                      Engine::max() == std::numeric_limits<uint64_t>::max(),
+                  "Needs an engine of 64 random bits");
+    uint64_t range = uint64_t(Unsigned(b) - Unsigned(a));
+    if (range == std::numeric_limits<uint64_t>::max()) {
+      return T(Unsigned(a) + engine());
+    }
+    uint64_t s = range + 1;
+    uint128 m = uint128(engine()) * s;
+    if (uint64_t(m) < s) {
+      uint64_t threshold = -s % s;
+      while (uint64_t(m) < threshold) {
+        m = uint128(engine()) * s;
+      }
+    }
+    return T(Unsigned(a) + Unsigned(m >> 64));
+  }
+
+private:
+  T a;
+  T b;
+};
+
+// True with probability p, from one draw
+class ThresholdBernoulliDistribution {
+public:
+  using result_type = bool;
+
+  ThresholdBernoulliDistribution(double p = 0.5)
+      : always(p >= 1), threshold(p > 0 ? uint64_t(p * 0x1p64) : 0) {}
+
+  template <typename Engine> bool operator()(Engine &engine) {
+    return always || engine() < threshold;
+  }
+
+private:
+  bool always;
+  uint64_t threshold;
+};
@@ -0,0 +1,284 @@
+#include "synthetic.hpp"
+
+#include <atomic>
+#include <iomanip>
+
+// Microbenchmarks of the hot paths, on the bundled examples and on random
+// graphs of growing size. Every benchmark repeats its operation for at least
+// --min_time milliseconds and reports time and allocations per operation.
+
+#ifndef AUTOGRAPH_EXAMPLES
+#define AUTOGRAPH_EXAMPLES "examples"
+#endif
+
+// Allocations made through operator new, for allocs/op. Kept out of line,
+// otherwise GCC takes the free in delete for a mismatched deallocation.
+std::atomic<uint64_t> n_allocations{0};
+
+[[gnu::noinline]] void *operator new(size_t size) {
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
+
+struct Result {
+  std::string name;
+  double ns_per_op;
+  double items_per_s;
+  double allocs_per_op;
+};
+
+struct Bench {
+
+  // Where the results table goes, the console is kept for it alone
+  std::ostream *table;
+  std::chrono::nanoseconds min_time;
+  std::string filter;
+  std::vector<Result> results;
+
+  // Time op, which handles items things (edge pairs, nodes...) per call
+  template <typename Op> void run(std::string name, double items, Op op);
+  void print(const Result &r);
+};
+
+template <typename Op> void Bench::run(std::string name, double items, Op op) {
+  if (name.find(filter) == std::string::npos) {
+    return;
+  }
+
+  // Warm up, then repeat until enough time has passed
+  op();
+  uint64_t allocations = n_allocations.load();
+  unsigned long n_ops = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::nanoseconds(0);
+  do {
+    op();
+    n_ops++;
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed < min_time);
+
+  double ns = double(elapsed.count()) / n_ops;
+  results.push_back({name, ns, items * 1e9 / ns,
+                     double(n_allocations.load() - allocations) / n_ops});
+  print(results.back());
+}
+
+void Bench::print(const Result &r) {
+  *table << std::left << std::setw(40) << r.name << std::right
+         << std::setw(16) << std::fixed << std::setprecision(0) << r.ns_per_op
+         << std::setw(16) << std::scientific << std::setprecision(3)
+         << r.items_per_s << std::setw(14) << std::fixed
+         << std::setprecision(1) << r.allocs_per_op << std::endl;
+}
+
+// Random graph with n nodes in each tower and about degree links per node
+Topology random_topology(unsigned int n, unsigned int degree) {
+  SyntheticSpec spec;
+  spec.n_t1 = n;
+  spec.n_t2 = n;
+  spec.density = double(degree) / n;
+  spec.structure = "none";
+  spec.seed = 42;
+  return generate(spec).topology;
+}
+
+// Every benchmark which needs only a graph
+void bench_graph(Bench &bench, std::string name, const Bipartate &graph) {
+  double n_nodes = graph.t1.size() + graph.t2.size();
+  double n_edges = graph.edges.size();
+
+  Bipartate b = graph;
+  bench.run("calc_score/" + name, n_edges * std::max(0.0, n_edges - 1) / 2,
+            [&] { b.calc_score(); });
+
+  b.calc_score();
+  // Scored on its own above, so only the copy and the moves are timed
+  bench.run("mutate/" + name, n_nodes,
+            [&] { Bipartate m = b.mutate(50, false); });
+
+  Generation g(graph);
+  bench.run("evolve/" + name, 50, [&] { g.evolve(50, 50); });
+
+  std::string dot_name = "autograph_bench.dot";
+  bench.run("write_dot/" + name, n_nodes + n_edges,
+            [&] { b.write_dot(dot_name); });
+  std::remove(dot_name.c_str());
+}
+
+// Time per generation of evolving graph on 1 to max_threads threads, with a
+// fixed population (strong scaling) and with one growing with the number of
+// threads (weak scaling)
+void bench_scaling(Bench &bench, std::string name, const Bipartate &graph,
+                   unsigned int max_threads, unsigned int n_specimen,
+                   unsigned int n_gens) {
+  for (bool weak : {false, true}) {
+    std::string kind = weak ? "weak" : "strong";
+    if ((kind + "/" + name).find(bench.filter) == std::string::npos) {
+      continue;
+    }
+    *bench.table << "\n"
+                 << kind << " scaling/" << name << "\n"
+                 << std::setw(8) << "threads" << std::setw(10) << "specimen"
+                 << std::setw(14) << "ms/gen" << std::setw(10) << "speedup"
+                 << std::setw(12) << "efficiency" << std::endl;
+
+    double base = 0;
+    for (unsigned int t = 1; t <= max_threads; t++) {
+      unsigned int s = weak ? n_specimen * t : n_specimen;
+
+      // Same mutations for every thread count, and a full population before
+      // timing starts
+      Random::seed(42);
+      Generation g(graph);
+      g.n_threads = t;
+      g.evolve(s, 50);
+
+      uint64_t allocations = n_allocations.load();
+      auto start = std::chrono::steady_clock::now();
+      for (unsigned int i = 0; i < n_gens; i++) {
+        g.evolve(s, 50);
+      }
+      double ns = double((std::chrono::steady_clock::now() - start).count()) /
+                  std::max(1u, n_gens);
+
+      // Weak scaling does t times the work, ideally in the same time
+      base = t == 1 ? ns : base;
+      double speedup = weak ? t * base / ns : base / ns;
+
+      *bench.table << std::setw(8) << t << std::setw(10) << s << std::fixed
+                   << std::setw(14) << std::setprecision(3) << ns / 1e6
+                   << std::setw(10) << std::setprecision(2) << speedup
+                   << std::setw(11) << std::setprecision(0)
+                   << 100 * speedup / t << "%" << std::endl;
+      bench.results.push_back(
+          {kind + "/" + name + "/" + std::to_string(t), ns, s * 1e9 / ns,
+           double(n_allocations.load() - allocations) / std::max(1u, n_gens)});
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+
+  argparse::ArgumentParser arguments("autograph_bench", "1.0");
+
+  // Optional argument
+  arguments.add_argument("-t", "--min_time")
+      .default_value(static_cast<unsigned int>(500))
+      .scan<'u', unsigned int>()
+      .help("Integer: Milliseconds to repeat each benchmark for");
+
+  // Optional argument
+  arguments.add_argument("-f", "--filter")
+      .default_value(std::string(""))
+      .help("Only run benchmarks whose name contains this");
+
+  // Optional argument
+  arguments.add_argument("-e", "--examples")
+      .default_value(std::string(AUTOGRAPH_EXAMPLES))
+      .help("Directory path: Where the example CSVs are");
+
+  // Optional argument
+  arguments.add_argument("--threads")
+      .default_value(static_cast<unsigned int>(0))
+      .scan<'u', unsigned int>()
+      .help("Integer: Also measure scaling of evolve on 1 to n threads");
+
+  // Optional argument
+  arguments.add_argument("--specimen")
+      .default_value(static_cast<unsigned int>(200))
+      .scan<'u', unsigned int>()
+      .help("Integer: Specimen per thread for the scaling runs");
+
+  // Optional argument
+  arguments.add_argument("--generations")
+      .default_value(static_cast<unsigned int>(5))
+      .scan<'u', unsigned int>()
+      .help("Integer: Generations timed per scaling run");
+
+  // Optional argument
+  arguments.add_argument("-r", "--report")
+      .default_value(std::string(""))
+      .help("File path: Also write the results as CSV");
+
+  try {
+    arguments.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::cerr << arguments;
+    std::exit(1);
+  }
+
+  // The code under test reports every file it writes, which would bury
+  // the results
+  std::ofstream null_stream;
+  std::streambuf *console = std::cout.rdbuf(null_stream.rdbuf());
+  std::ostream table(console);
+
+  Bench bench;
+  bench.table = &table;
+  bench.min_time =
+      std::chrono::milliseconds(arguments.get<unsigned int>("-t"));
+  bench.filter = arguments.get<std::string>("-f");
+  std::string examples = arguments.get<std::string>("-e");
+
+  // Same graphs and mutations on every run
+  Random::seed(42);
+
+  table << std::left << std::setw(40) << "benchmark" << std::right
+        << std::setw(16) << "ns/op" << std::setw(16) << "items/s"
+        << std::setw(14) << "allocs/op" << std::endl;
+
+  // Every graph benchmarked, for the scaling runs
+  std::vector<std::pair<std::string, Bipartate>> workloads;
+
+  for (std::string name : {"test", "small_matrix", "medium_matrix", "med_mat",
+                           "big_example", "adjacency_matrix"}) {
+    std::string csv_name = examples + "/" + name + ".csv";
+    Bipartate graph;
+    try {
+      graph = Bipartate(csv_name, false);
+    } catch (const std::runtime_error &err) {
+      std::cerr << "ERROR: " << csv_name << ": " << err.what() << std::endl;
+      continue;
+    }
+
+    double n_bytes = MappedFile(csv_name).size;
+    bench.run("load_csv/" + name, n_bytes,
+              [&] { Bipartate b(csv_name, false); });
+    bench_graph(bench, name, graph);
+    workloads.push_back({name, graph});
+  }
+
+  for (unsigned int n : {250, 1000, 2500}) {
+    workloads.push_back(
+        {"random_" + std::to_string(n), Bipartate(random_topology(n, 2))});
+    bench_graph(bench, workloads.back().first, workloads.back().second);
+  }
+
+  if (unsigned int max_threads = arguments.get<unsigned int>("--threads")) {
+    for (auto &[name, graph] : workloads) {
+      bench_scaling(bench, name, graph, max_threads,
+                    arguments.get<unsigned int>("--specimen"),
+                    arguments.get<unsigned int>("--generations"));
+    }
+  }
+
+  std::cout.rdbuf(console);
+
+  std::string report = arguments.get<std::string>("-r");
+  if (!report.empty()) {
+    std::ofstream f(report);
+    f << "benchmark,ns_per_op,items_per_s,allocs_per_op\n";
+    for (auto &r : bench.results) {
+      f << r.name << "," << r.ns_per_op << "," << r.items_per_s << ","
+        << r.allocs_per_op << "\n";
+    }
+  }
+}
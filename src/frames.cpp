@@ -0,0 +1,175 @@
+#include "autograph.hpp"
+
+// Expands a trajectory log written with autograph --trajectory back into
+// one dot file per snapshot, the same as autograph writes them.
+
+// Find "key": in a record, returning where its value starts
+const char *find_key(const std::string &line, std::string key) {
+  size_t at = line.find("\"" + key + "\":");
+  if (at == std::string::npos) {
+    throw std::runtime_error("Record has no \"" + key + "\"");
+  }
+  return line.data() + at + key.size() + 3;
+}
+
+long parse_long(const char *&p, const char *end) {
+  long value = 0;
+  while (p < end && (*p == ' ' || *p == ',' || *p == '[')) {
+    p++;
+  }
+  auto [next, ec] = std::from_chars(p, end, value);
+  if (ec != std::errc()) {
+    throw std::runtime_error("Expected a number");
+  }
+  p = next;
+  return value;
+}
+
+// Parse an array of arrays of n integers, [[a,b,c],[d,e,f],...]
+std::vector<long> parse_tuples(const char *p, const char *end, unsigned int n) {
+  std::vector<long> values;
+  while (p < end && *p != '[') {
+    p++;
+  }
+  p++;
+  while (p < end && *p != ']') {
+    while (p < end && (*p == ',' || *p == ' ')) {
+      p++;
+    }
+    if (*p == ']') {
+      break;
+    }
+    for (unsigned int i = 0; i < n; i++) {
+      values.push_back(parse_long(p, end));
+    }
+    while (p < end && *p != ']') {
+      p++;
+    }
+    p++;
+  }
+  return values;
+}
+
+// Parse an array of JSON strings, ["a","b",...], into labels
+std::vector<unsigned int> parse_labels(const char *p, const char *end,
+                                       Labels &labels) {
+  std::vector<unsigned int> ids;
+  std::string label;
+  while (p < end && *p != ']') {
+    if (*p++ != '"') {
+      continue;
+    }
+    label.clear();
+    for (; p < end && *p != '"'; p++) {
+      if (*p == '\\') {
+        p++;
+      }
+      label += *p;
+    }
+    p++;
+    ids.push_back(labels.add(label));
+  }
+  return ids;
+}
+
+int main(int argc, char **argv) {
+
+  argparse::ArgumentParser arguments("autograph_frames", "1.0");
+
+  // Positional argument accepting the trajectory log
+  arguments.add_argument("LOG").help("File path: Trajectory log");
+
+  // Optional argument
+  arguments.add_argument("-o", "--prefix")
+      .default_value(std::string("best_gen_"))
+      .help("Frames are written to <prefix><generation>.dot");
+
+  // Optional argument
+  arguments.add_argument("-e", "--every")
+      .default_value(static_cast<unsigned int>(1))
+      .scan<'u', unsigned int>()
+      .help("Integer: Only write every n-th snapshot");
+
+  try {
+    arguments.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::cerr << arguments;
+    std::exit(1);
+  }
+
+  std::string log_name = arguments.get<std::string>("LOG");
+  std::string prefix = arguments.get<std::string>("-o");
+  unsigned int every = std::max(1u, arguments.get<unsigned int>("-e"));
+
+  std::ifstream f(log_name);
+  if (!f) {
+    std::cerr << "ERROR: Could not open " << log_name << std::endl;
+    std::exit(1);
+  }
+
+  Bipartate graph;
+  bool have_graph = false;
+  std::vector<Pos> genome;
+  unsigned int n_snapshot = 0;
+  unsigned int n_line = 0;
+  std::string line;
+  try {
+    while (std::getline(f, line)) {
+      n_line++;
+      const char *end = line.data() + line.size();
+
+      // A new graph, as written when a run starts
+      if (line.starts_with("{\"graph\":")) {
+        const char *p = find_key(line, "t1");
+        unsigned int n_t1 = parse_long(p, end);
+        p = find_key(line, "t2");
+        unsigned int n_t2 = parse_long(p, end);
+
+        std::vector<Triplet> cells;
+        std::vector<long> edges = parse_tuples(find_key(line, "edges"), end, 3);
+        for (size_t i = 0; i < edges.size(); i += 3) {
+          cells.push_back({static_cast<unsigned int>(edges[i]),
+                           static_cast<unsigned int>(edges[i + 1]),
+                           static_cast<int>(edges[i + 2])});
+        }
+        Labels labels;
+        std::vector<unsigned int> t1_labels;
+        std::vector<unsigned int> t2_labels;
+        if (line.find("\"t1_labels\":") != std::string::npos) {
+          t1_labels = parse_labels(find_key(line, "t1_labels"), end, labels);
+          t2_labels = parse_labels(find_key(line, "t2_labels"), end, labels);
+        }
+
+        Topology topology = from_triplets(n_t1, n_t2, cells);
+        topology.labels = labels;
+        topology.t1_labels = t1_labels;
+        topology.t2_labels = t2_labels;
+        graph = Bipartate(topology);
+        genome = graph.genome();
+        have_graph = true;
+        n_snapshot = 0;
+        continue;
+      }
+
+      if (!have_graph) {
+        throw std::runtime_error("Snapshot before any graph");
+      }
+      const char *p = find_key(line, "gen");
+      long generation = parse_long(p, end);
+      std::vector<long> moved = parse_tuples(find_key(line, "moved"), end, 3);
+      for (size_t i = 0; i < moved.size(); i += 3) {
+        genome.at(moved[i]) = Pos(moved[i + 1], moved[i + 2]);
+      }
+
+      if (!(n_snapshot++ % every)) {
+        graph.set_genome(genome);
+        graph.write_dot(prefix + std::to_string(generation) + ".dot");
+      }
+    }
+  } catch (const std::exception &err) {
+    std::cerr << "ERROR: " << log_name << " line " << n_line << ": ";
+    std::cerr << err.what() << std::endl;
+    std::exit(1);
+  }
+}
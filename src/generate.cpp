@@ -0,0 +1,136 @@
+#include "synthetic.hpp"
+
+// Writes a random bipartate graph with a planted layout, along with that
+// layout as a permutation and its crossing count, for testing autograph on
+// graphs whose good solution is known.
+
+int main(int argc, char **argv) {
+
+  argparse::ArgumentParser arguments("autograph_generate", "1.0");
+
+  // Positional argument accepting the output file
+  arguments.add_argument("OUT").help(
+      "File path: Graph to write, as .csv, .edges or .mtx");
+
+  // Optional argument
+  arguments.add_argument("--t1")
+      .default_value(static_cast<unsigned int>(1000))
+      .scan<'u', unsigned int>()
+      .help("Integer: Number of rows");
+
+  // Optional argument
+  arguments.add_argument("--t2")
+      .default_value(static_cast<unsigned int>(1000))
+      .scan<'u', unsigned int>()
+      .help("Integer: Number of columns");
+
+  // Optional argument
+  arguments.add_argument("-d", "--density")
+      .default_value(0.002)
+      .scan<'g', double>()
+      .help("Float: Fraction of cells which are linked");
+
+  // Optional argument
+  arguments.add_argument("--degrees")
+      .default_value(std::string("uniform"))
+      .action([](const std::string &value) {
+        if (value != "uniform" && value != "powerlaw") {
+          throw std::runtime_error("--degrees must be uniform or powerlaw");
+        }
+        return value;
+      })
+      .help("Row degree distribution: uniform or powerlaw");
+
+  // Optional argument
+  arguments.add_argument("--exponent")
+      .default_value(2.5)
+      .scan<'g', double>()
+      .help("Float: Exponent of the powerlaw degrees");
+
+  // Optional argument
+  arguments.add_argument("-c", "--components")
+      .default_value(static_cast<unsigned int>(1))
+      .scan<'u', unsigned int>()
+      .help("Integer: Number of disconnected components");
+
+  // Optional argument
+  arguments.add_argument("--structure")
+      .default_value(std::string("diagonal"))
+      .action([](const std::string &value) {
+        if (value != "none" && value != "block" && value != "diagonal") {
+          throw std::runtime_error(
+              "--structure must be none, block or diagonal");
+        }
+        return value;
+      })
+      .help("Planted layout in each component: none, block or diagonal");
+
+  // Optional argument
+  arguments.add_argument("-b", "--blocks")
+      .default_value(static_cast<unsigned int>(4))
+      .scan<'u', unsigned int>()
+      .help("Integer: Blocks per component for --structure block");
+
+  // Optional argument
+  arguments.add_argument("-n", "--noise")
+      .default_value(0.0)
+      .scan<'g', double>()
+      .help("Float: Fraction of edges placed ignoring the structure");
+
+  // Optional argument
+  arguments.add_argument("--seed")
+      .default_value(static_cast<unsigned int>(1))
+      .scan<'u', unsigned int>()
+      .help("Integer: Same seed and options give the same graph");
+
+  // Optional argument
+  arguments.add_argument("-p", "--perm")
+      .default_value(std::string(""))
+      .help("File path: Planted layout, defaults to OUT with .perm");
+
+  try {
+    arguments.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::cerr << arguments;
+    std::exit(1);
+  }
+
+  SyntheticSpec spec;
+  spec.n_t1 = arguments.get<unsigned int>("--t1");
+  spec.n_t2 = arguments.get<unsigned int>("--t2");
+  spec.density = arguments.get<double>("-d");
+  spec.degrees = arguments.get<std::string>("--degrees");
+  spec.exponent = arguments.get<double>("--exponent");
+  spec.components = arguments.get<unsigned int>("-c");
+  spec.structure = arguments.get<std::string>("--structure");
+  spec.blocks = arguments.get<unsigned int>("-b");
+  spec.noise = arguments.get<double>("-n");
+  spec.seed = arguments.get<unsigned int>("--seed");
+
+  std::string out_name = arguments.get<std::string>("OUT");
+  std::string perm_name = arguments.get<std::string>("-p");
+  if (perm_name.empty()) {
+    perm_name = out_name.substr(0, out_name.find_last_of('.')) + ".perm";
+  }
+
+  SyntheticGraph graph = generate(spec);
+
+  std::cout << "Writing " + out_name + "\n" << std::flush;
+  write_topology(out_name, graph.topology);
+
+  // Same layout as the .perm files written by autograph --reordered
+  TextBuffer out;
+  for (bool c : {true, false}) {
+    out << (c ? "t1" : "t2");
+    for (unsigned int id : c ? graph.t1_order : graph.t2_order) {
+      out << ',' << id;
+    }
+    out << '\n';
+  }
+  std::cout << "Writing " + perm_name + "\n" << std::flush;
+  out.write(perm_name);
+
+  std::cout << "Edges: " << graph.topology.n_edges() << "\n";
+  std::cout << "Planted crossings: " << graph.planted_crossings << std::endl;
+}
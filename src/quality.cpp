@@ -0,0 +1,353 @@
+#include "synthetic.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <optional>
+
+// Runs optimisers over a corpus of graphs with several seeds, recording the
+// best crossing count over wall-clock time. Each run is summed up by the
+// area under that curve and by the time it takes to reach a target, so
+// configurations can be compared on how fast they get to a good layout
+// rather than only on where they end up.
+
+#ifndef AUTOGRAPH_EXAMPLES
+#define AUTOGRAPH_EXAMPLES "examples"
+#endif
+
+// Best crossings so far, after this many seconds
+struct Point {
+  double seconds;
+  unsigned int crossings;
+};
+
+// Runs on graph until budget seconds have passed, calling improved with
+// every new best
+using Engine = std::function<void(const Bipartate &graph, double budget,
+                                  std::function<void(unsigned int)> improved)>;
+
+// Engine from its parameters, as given after its name in -e name:k=v,...
+using EngineFactory =
+    std::function<Engine(const std::map<std::string, double> &params)>;
+
+double param(const std::map<std::string, double> &params, std::string key,
+             double fallback) {
+  auto it = params.find(key);
+  return it == params.end() ? fallback : it->second;
+}
+
+// The genetic algorithm autograph runs: s specimen, mutation probability p,
+// children scored on t threads, adapting p and the move odds if a is 1
+Engine genetic(const std::map<std::string, double> &params) {
+  unsigned int n_specimen = param(params, "s", 100);
+  uint8_t chance = std::clamp(param(params, "p", 50), 0.0, 100.0);
+  unsigned int n_threads = param(params, "t", 1);
+  bool adaptive = param(params, "a", 0);
+  return [=](const Bipartate &graph, double budget,
+             std::function<void(unsigned int)> improved) {
+    auto start = std::chrono::steady_clock::now();
+    Generation g(graph);
+    g.n_threads = n_threads;
+    g.adaptive = adaptive;
+    g.adaptive_chance = chance;
+    unsigned int best = g.specimen[0].score;
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+               .count() < budget &&
+           best) {
+      g.evolve(n_specimen, chance);
+      if (g.best_score < best) {
+        best = g.best_score;
+        improved(best);
+      }
+    }
+  };
+}
+
+std::map<std::string, EngineFactory> engines = {{"ga", genetic}};
+
+// name:k=v,k=v
+std::pair<std::string, std::map<std::string, double>>
+parse_engine(const std::string &spec) {
+  size_t colon = spec.find(':');
+  std::string name = spec.substr(0, colon);
+  std::map<std::string, double> params;
+  if (colon != std::string::npos) {
+    std::stringstream list(spec.substr(colon + 1));
+    std::string pair;
+    while (std::getline(list, pair, ',')) {
+      size_t equals = pair.find('=');
+      if (equals == std::string::npos) {
+        throw std::runtime_error("Expected key=value in " + spec);
+      }
+      params[pair.substr(0, equals)] = std::stod(pair.substr(equals + 1));
+    }
+  }
+  if (!engines.contains(name)) {
+    throw std::runtime_error("No engine called " + name);
+  }
+  return {name, params};
+}
+
+struct Workload {
+  std::string name;
+  Bipartate graph;
+
+  // Crossings of a known layout, for generated graphs
+  std::optional<unsigned long> planted;
+};
+
+struct Run {
+  std::string graph;
+  std::string engine;
+  unsigned int seed;
+  std::vector<Point> curve;
+
+  // Filled in once every run on the graph is done
+  double auc;
+  std::optional<double> time_to_target;
+};
+
+// Mean of best / initial crossings over the budget, from 1 for no progress
+// down to 0 for a layout without crossings found at once
+double area_under_curve(const std::vector<Point> &curve, double budget) {
+  if (!curve.front().crossings) {
+    return 0;
+  }
+  double area = 0;
+  for (size_t i = 0; i < curve.size(); i++) {
+    double until = i + 1 < curve.size() ? curve[i + 1].seconds : budget;
+    area += curve[i].crossings * (std::min(until, budget) - curve[i].seconds);
+  }
+  return area / budget / curve.front().crossings;
+}
+
+std::optional<double> time_to_target(const std::vector<Point> &curve,
+                                     unsigned long target) {
+  for (const Point &p : curve) {
+    if (p.crossings <= target) {
+      return p.seconds;
+    }
+  }
+  return std::nullopt;
+}
+
+int main(int argc, char **argv) {
+
+  argparse::ArgumentParser arguments("autograph_quality", "1.0");
+
+  // Optional argument
+  arguments.add_argument("-e", "--engine")
+      .default_value(std::vector<std::string>{"ga:s=100,p=50", "ga:s=20,p=50",
+                                              "ga:s=100,p=10"})
+      .append()
+      .help("name:k=v,...: Engine and parameters to run, may be repeated. "
+            "ga takes s, p and t as in autograph, and a=1 for --adaptive");
+
+  // Optional argument
+  arguments.add_argument("-b", "--budget")
+      .default_value(2.0)
+      .scan<'g', double>()
+      .help("Float: Seconds each run is given");
+
+  // Optional argument
+  arguments.add_argument("--seeds")
+      .default_value(static_cast<unsigned int>(3))
+      .scan<'u', unsigned int>()
+      .help("Integer: Runs per engine and graph, seeded 1 to n");
+
+  // Optional argument
+  arguments.add_argument("--tolerance")
+      .default_value(5.0)
+      .scan<'g', double>()
+      .help("Float: Target is this many percent above the best known");
+
+  // Optional argument
+  arguments.add_argument("--examples")
+      .default_value(std::string(AUTOGRAPH_EXAMPLES))
+      .help("Directory path: CSVs to include, empty for none");
+
+  // Optional argument
+  arguments.add_argument("--generated")
+      .default_value(std::vector<unsigned int>{100, 300})
+      .scan<'u', unsigned int>()
+      .append()
+      .help("Integer: Sizes of generated graphs to include, may be repeated");
+
+  // Optional argument
+  arguments.add_argument("-f", "--filter")
+      .default_value(std::string(""))
+      .help("Only use graphs whose name contains this");
+
+  // Optional argument
+  arguments.add_argument("-o", "--out")
+      .default_value(std::string(""))
+      .help("File path: Write every run's metrics as CSV");
+
+  // Optional argument
+  arguments.add_argument("--curves")
+      .default_value(std::string(""))
+      .help("File path: Write every run's best crossings over time as CSV");
+
+  std::vector<std::pair<std::string, std::map<std::string, double>>> configs;
+  try {
+    arguments.parse_args(argc, argv);
+    for (auto &spec : arguments.get<std::vector<std::string>>("-e")) {
+      configs.push_back(parse_engine(spec));
+    }
+  } catch (const std::exception &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::cerr << arguments;
+    std::exit(1);
+  }
+
+  double budget = arguments.get<double>("-b");
+  unsigned int n_seeds = std::max(1u, arguments.get<unsigned int>("--seeds"));
+  double tolerance = arguments.get<double>("--tolerance");
+  std::string filter = arguments.get<std::string>("-f");
+
+  std::vector<Workload> corpus;
+  std::string examples = arguments.get<std::string>("--examples");
+  if (!examples.empty()) {
+    std::vector<std::filesystem::path> csvs;
+    for (auto &entry : std::filesystem::directory_iterator(examples)) {
+      if (entry.path().extension() == ".csv") {
+        csvs.push_back(entry.path());
+      }
+    }
+    std::sort(csvs.begin(), csvs.end());
+    for (auto &path : csvs) {
+      try {
+        corpus.push_back({path.stem().string(),
+                          Bipartate(path.string(), false), std::nullopt});
+      } catch (const std::runtime_error &err) {
+        std::cerr << "ERROR: " << path << ": " << err.what() << std::endl;
+      }
+    }
+  }
+  for (unsigned int n :
+       arguments.get<std::vector<unsigned int>>("--generated")) {
+    for (std::string structure : {"diagonal", "block", "none"}) {
+      SyntheticSpec spec;
+      spec.n_t1 = n;
+      spec.n_t2 = n;
+      spec.density = 2.0 / n;
+      spec.structure = structure;
+      SyntheticGraph g = generate(spec);
+      corpus.push_back({structure + "_" + std::to_string(n),
+                        Bipartate(g.topology), g.planted_crossings});
+    }
+  }
+  std::erase_if(corpus, [&](const Workload &w) {
+    return w.name.find(filter) == std::string::npos;
+  });
+
+  std::vector<Run> runs;
+  for (Workload &w : corpus) {
+    size_t first_run = runs.size();
+    for (auto &[name, params] : configs) {
+      Engine engine = engines[name](params);
+      std::ostringstream label;
+      label << name;
+      for (auto &[key, value] : params) {
+        label << (&key == &params.begin()->first ? ":" : ",") << key << "="
+              << value;
+      }
+
+      for (unsigned int seed = 1; seed <= n_seeds; seed++) {
+        std::cout << "Running " + label.str() + " on " + w.name +
+                         ", seed " + std::to_string(seed) + "\n"
+                  << std::flush;
+        Random::seed(seed);
+        Bipartate graph = w.graph;
+        graph.calc_score();
+
+        Run run{w.name, label.str(), seed, {{0, graph.score}}, 0, std::nullopt};
+        auto start = std::chrono::steady_clock::now();
+        engine(graph, budget, [&](unsigned int crossings) {
+          double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+          run.curve.push_back({seconds, crossings});
+        });
+        runs.push_back(run);
+      }
+    }
+
+    // Target from the best any run found, or the planted layout if better
+    unsigned long best_known = ULONG_MAX;
+    for (size_t i = first_run; i < runs.size(); i++) {
+      best_known =
+          std::min<unsigned long>(best_known, runs[i].curve.back().crossings);
+    }
+    if (w.planted) {
+      best_known = std::min(best_known, *w.planted);
+    }
+    unsigned long target = best_known * (1 + tolerance / 100);
+    for (size_t i = first_run; i < runs.size(); i++) {
+      runs[i].auc = area_under_curve(runs[i].curve, budget);
+      runs[i].time_to_target = time_to_target(runs[i].curve, target);
+    }
+  }
+
+  // Summary per graph and engine, over the seeds
+  std::cout << "\n"
+            << std::left << std::setw(20) << "graph" << std::setw(24)
+            << "engine" << std::right << std::setw(10) << "best"
+            << std::setw(10) << "auc" << std::setw(10) << "reached"
+            << std::setw(12) << "median ttt" << std::endl;
+  for (size_t i = 0; i < runs.size(); i += n_seeds) {
+    double best = 0;
+    double auc = 0;
+    std::vector<double> times;
+    for (size_t j = i; j < i + n_seeds; j++) {
+      best += runs[j].curve.back().crossings;
+      auc += runs[j].auc;
+      if (runs[j].time_to_target) {
+        times.push_back(*runs[j].time_to_target);
+      }
+    }
+    std::sort(times.begin(), times.end());
+
+    // Runs which never reach the target count as slowest
+    std::string median = "-";
+    if (times.size() > n_seeds / 2) {
+      median = std::to_string(times[n_seeds / 2]).substr(0, 6) + "s";
+    }
+    std::cout << std::left << std::setw(20) << runs[i].graph << std::setw(24)
+              << runs[i].engine << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << best / n_seeds
+              << std::setprecision(3) << std::setw(10) << auc / n_seeds
+              << std::setw(10)
+              << std::to_string(times.size()) + "/" + std::to_string(n_seeds)
+              << std::setw(12) << median << std::endl;
+  }
+
+  std::string out = arguments.get<std::string>("-o");
+  if (!out.empty()) {
+    std::ofstream f(out);
+    f << "graph,engine,seed,initial,best,auc,time_to_target\n";
+    for (Run &r : runs) {
+      f << r.graph << ",\"" << r.engine << "\"," << r.seed << ","
+        << r.curve.front().crossings << "," << r.curve.back().crossings << ","
+        << r.auc << ",";
+      if (r.time_to_target) {
+        f << *r.time_to_target;
+      }
+      f << "\n";
+    }
+  }
+
+  std::string curves = arguments.get<std::string>("--curves");
+  if (!curves.empty()) {
+    std::ofstream f(curves);
+    f << "graph,engine,seed,seconds,crossings\n";
+    for (Run &r : runs) {
+      for (Point &p : r.curve) {
+        f << r.graph << ",\"" << r.engine << "\"," << r.seed << ","
+          << p.seconds << "," << p.crossings << "\n";
+      }
+    }
+  }
+}